@@ -0,0 +1,32 @@
+/*
+	Per-relation arena. The intermediate structures of one relation's
+  analysis (closure engines, the S matrix, the lossless join test, 3NF
+  fragment pruning) are bump allocated, first from a buffer inside the
+  arena and then from blocks of growing size. Nothing is freed until the
+  arena is destroyed, so only structures of bounded size are put in it;
+  scratch space used over and over is kept and reused by its owner.
+*/
+
+#include <memory_resource>
+#include "relational.h"
+
+using namespace std;
+
+static thread_local RelationArena *currentArena = NULL;
+
+RelationArena::RelationArena()
+  : blocks(buffer, sizeof(buffer), pmr::new_delete_resource()) {
+  previous = currentArena;
+  currentArena = this;
+}
+
+RelationArena::~RelationArena() {
+  currentArena = previous;
+}
+
+//The arena of the innermost RelationArena alive on this thread, or the
+//global heap if there is none
+pmr::memory_resource *RelationArena::current() {
+  if(currentArena == NULL) return pmr::new_delete_resource();
+  return &currentArena->blocks;
+}
@@ -0,0 +1,350 @@
+/*
+	Bitset encoding of attribute sets and functional dependencies.
+  Attribute names are interned into dense integer ids by an
+  AttributeDictionary; a set of attributes is then a bitset over those ids.
+*/
+
+#ifndef ATTRSET_H
+#define ATTRSET_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+
+using namespace std;
+
+//A set of attribute ids stored as a bitset. Up to InlineWords 64-bit words
+//(64 * InlineWords attributes) live inside the object; wider sets spill to
+//the heap. Words past the ones in use are implicitly zero.
+template<int InlineWords>
+class BasicAttrSet {
+  private:
+  int nwords;
+  uint64_t local[InlineWords];
+  vector<uint64_t> spill;
+
+  uint64_t *wordData() { return nwords > InlineWords ? spill.data() : local; }
+  void grow(int words);
+
+  public:
+  class iterator {
+    private:
+    const BasicAttrSet *s;
+    int w;
+    uint64_t bits;
+    void settle();
+
+    public:
+    iterator(const BasicAttrSet *s, int w);
+    int operator*() const { return w * 64 + __builtin_ctzll(bits); }
+    iterator &operator++() { bits &= bits - 1; settle(); return *this; }
+    bool operator!=(const iterator &o) const { return w != o.w || bits != o.bits; }
+  };
+
+  BasicAttrSet();
+  BasicAttrSet(const BasicAttrSet &o);
+  BasicAttrSet &operator=(const BasicAttrSet &o);
+
+  int words() const { return nwords; }
+  const uint64_t *data() const { return nwords > InlineWords ? spill.data() : local; }
+  uint64_t word(int i) const { return i < nwords ? data()[i] : 0; }
+
+  void insert(int id);
+  void insertWords(const uint64_t *bits, int n);
+  void erase(int id);
+  bool contains(int id) const;
+  int count() const;
+  bool empty() const;
+  void clear();
+  bool isSubsetOf(const BasicAttrSet &o) const;
+  bool intersects(const BasicAttrSet &o) const;
+
+  BasicAttrSet &operator|=(const BasicAttrSet &o);
+  BasicAttrSet &operator&=(const BasicAttrSet &o);
+  BasicAttrSet &operator-=(const BasicAttrSet &o);
+  BasicAttrSet operator|(const BasicAttrSet &o) const { BasicAttrSet r = *this; r |= o; return r; }
+  BasicAttrSet operator&(const BasicAttrSet &o) const { BasicAttrSet r = *this; r &= o; return r; }
+  BasicAttrSet operator-(const BasicAttrSet &o) const { BasicAttrSet r = *this; r -= o; return r; }
+
+  bool operator==(const BasicAttrSet &o) const;
+  bool operator!=(const BasicAttrSet &o) const { return !(*this == o); }
+  bool operator<(const BasicAttrSet &o) const;
+  size_t hash() const;
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, nwords); }
+};
+
+typedef BasicAttrSet<4> AttrSet;
+
+//A functional dependency LHS -> RHS
+typedef pair<AttrSet, AttrSet> FD;
+typedef set<FD> FDSet;
+
+struct AttrSetHash {
+  size_t operator()(const AttrSet &s) const { return s.hash(); }
+};
+
+//Maps attribute names to the ids used in AttrSet and back
+class AttributeDictionary {
+  private:
+  vector<string> names;
+  unordered_map<string, int> ids;
+
+  public:
+  int intern(const string &name);
+  int find(const string &name) const;
+  void sortByName();
+  const string &getName(int id) const { return names[id]; }
+  int size() const { return names.size(); }
+  AttrSet encode(const set<string> &s);
+  set<string> decode(const AttrSet &s) const;
+};
+
+
+template<int InlineWords>
+BasicAttrSet<InlineWords>::iterator::iterator(const BasicAttrSet *s, int w) {
+  this->s = s;
+  this->w = w;
+  bits = w < s->nwords ? s->data()[w] : 0;
+  settle();
+}
+
+template<int InlineWords>
+void BasicAttrSet<InlineWords>::iterator::settle() {
+  while(bits == 0 && w < s->nwords) {
+    w++;
+    bits = w < s->nwords ? s->data()[w] : 0;
+  }
+}
+
+template<int InlineWords>
+BasicAttrSet<InlineWords>::BasicAttrSet() {
+  nwords = 0;
+}
+
+template<int InlineWords>
+BasicAttrSet<InlineWords>::BasicAttrSet(const BasicAttrSet &o) {
+  nwords = o.nwords;
+  if(nwords > InlineWords) {
+    spill = o.spill;
+  } else {
+    for(int i = 0; i<nwords; i++) local[i] = o.local[i];
+  }
+}
+
+template<int InlineWords>
+BasicAttrSet<InlineWords> &BasicAttrSet<InlineWords>::operator=(const BasicAttrSet &o) {
+  if(this == &o) return *this;
+  nwords = o.nwords;
+  if(nwords > InlineWords) {
+    spill = o.spill;
+  } else {
+    spill.clear();
+    for(int i = 0; i<nwords; i++) local[i] = o.local[i];
+  }
+  return *this;
+}
+
+template<int InlineWords>
+void BasicAttrSet<InlineWords>::grow(int words) {
+  if(words <= nwords) return;
+  if(words > InlineWords) {
+    if(nwords <= InlineWords) {
+      spill.assign(local, local + nwords);
+    }
+    spill.resize(words, 0);
+  } else {
+    for(int i = nwords; i<words; i++) local[i] = 0;
+  }
+  nwords = words;
+}
+
+template<int InlineWords>
+void BasicAttrSet<InlineWords>::insert(int id) {
+  grow(id / 64 + 1);
+  wordData()[id / 64] |= uint64_t(1) << (id % 64);
+}
+
+//Adds every id set in the n words of bits
+template<int InlineWords>
+void BasicAttrSet<InlineWords>::insertWords(const uint64_t *bits, int n) {
+  while(n > 0 && bits[n - 1] == 0) n--;
+  grow(n);
+  uint64_t *d = wordData();
+  for(int i = 0; i<n; i++) d[i] |= bits[i];
+}
+
+template<int InlineWords>
+void BasicAttrSet<InlineWords>::erase(int id) {
+  if(id / 64 < nwords) {
+    wordData()[id / 64] &= ~(uint64_t(1) << (id % 64));
+  }
+}
+
+template<int InlineWords>
+bool BasicAttrSet<InlineWords>::contains(int id) const {
+  return (word(id / 64) >> (id % 64)) & 1;
+}
+
+template<int InlineWords>
+int BasicAttrSet<InlineWords>::count() const {
+  int c = 0;
+  const uint64_t *d = data();
+  for(int i = 0; i<nwords; i++) c += __builtin_popcountll(d[i]);
+  return c;
+}
+
+template<int InlineWords>
+bool BasicAttrSet<InlineWords>::empty() const {
+  const uint64_t *d = data();
+  for(int i = 0; i<nwords; i++) {
+    if(d[i]) return false;
+  }
+  return true;
+}
+
+template<int InlineWords>
+void BasicAttrSet<InlineWords>::clear() {
+  nwords = 0;
+  spill.clear();
+}
+
+template<int InlineWords>
+bool BasicAttrSet<InlineWords>::isSubsetOf(const BasicAttrSet &o) const {
+  const uint64_t *d = data();
+  for(int i = 0; i<nwords; i++) {
+    if(d[i] & ~o.word(i)) return false;
+  }
+  return true;
+}
+
+template<int InlineWords>
+bool BasicAttrSet<InlineWords>::intersects(const BasicAttrSet &o) const {
+  const uint64_t *d = data();
+  for(int i = 0; i<nwords; i++) {
+    if(d[i] & o.word(i)) return true;
+  }
+  return false;
+}
+
+template<int InlineWords>
+BasicAttrSet<InlineWords> &BasicAttrSet<InlineWords>::operator|=(const BasicAttrSet &o) {
+  grow(o.nwords);
+  uint64_t *d = wordData();
+  const uint64_t *od = o.data();
+  for(int i = 0; i<o.nwords; i++) d[i] |= od[i];
+  return *this;
+}
+
+template<int InlineWords>
+BasicAttrSet<InlineWords> &BasicAttrSet<InlineWords>::operator&=(const BasicAttrSet &o) {
+  uint64_t *d = wordData();
+  for(int i = 0; i<nwords; i++) d[i] &= o.word(i);
+  return *this;
+}
+
+template<int InlineWords>
+BasicAttrSet<InlineWords> &BasicAttrSet<InlineWords>::operator-=(const BasicAttrSet &o) {
+  uint64_t *d = wordData();
+  for(int i = 0; i<nwords; i++) d[i] &= ~o.word(i);
+  return *this;
+}
+
+template<int InlineWords>
+bool BasicAttrSet<InlineWords>::operator==(const BasicAttrSet &o) const {
+  int n = max(nwords, o.nwords);
+  for(int i = 0; i<n; i++) {
+    if(word(i) != o.word(i)) return false;
+  }
+  return true;
+}
+
+//Orders sets the way std::set<string> orders its contents when ids are
+//assigned in name order: lexicographically by ascending member ids.
+template<int InlineWords>
+bool BasicAttrSet<InlineWords>::operator<(const BasicAttrSet &o) const {
+  int n = max(nwords, o.nwords);
+  for(int i = 0; i<n; i++) {
+    uint64_t a = word(i), b = o.word(i);
+    if(a == b) continue;
+    uint64_t low = (a ^ b) & -(a ^ b);
+    if(b & low) {
+      //The first difference is a member of o; this is smaller only if it
+      //runs out of members there
+      uint64_t above = ~(low | (low - 1));
+      if(a & above) return false;
+      for(int j = i + 1; j<n; j++) {
+        if(word(j)) return false;
+      }
+      return true;
+    }
+    uint64_t above = ~(low | (low - 1));
+    if(b & above) return true;
+    for(int j = i + 1; j<n; j++) {
+      if(o.word(j)) return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+template<int InlineWords>
+size_t BasicAttrSet<InlineWords>::hash() const {
+  uint64_t h = 14695981039346656037ULL;
+  const uint64_t *d = data();
+  int n = nwords;
+  while(n > 0 && d[n - 1] == 0) n--;
+  for(int i = 0; i<n; i++) {
+    h ^= d[i];
+    h *= 1099511628211ULL;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+
+inline int AttributeDictionary::intern(const string &name) {
+  auto itr = ids.find(name);
+  if(itr != ids.end()) return itr->second;
+  int id = names.size();
+  names.push_back(name);
+  ids[name] = id;
+  return id;
+}
+
+inline int AttributeDictionary::find(const string &name) const {
+  auto itr = ids.find(name);
+  return itr == ids.end() ? -1 : itr->second;
+}
+
+//Renumbers the attributes so that ids follow name order. Sets encoded
+//before the call are invalidated.
+inline void AttributeDictionary::sortByName() {
+  sort(names.begin(), names.end());
+  for(int i = 0; i<(int)names.size(); i++) {
+    ids[names[i]] = i;
+  }
+}
+
+inline AttrSet AttributeDictionary::encode(const set<string> &s) {
+  AttrSet encoded;
+  for(auto &name: s) {
+    encoded.insert(intern(name));
+  }
+  return encoded;
+}
+
+inline set<string> AttributeDictionary::decode(const AttrSet &s) const {
+  set<string> decoded;
+  for(int id: s) {
+    decoded.insert(names[id]);
+  }
+  return decoded;
+}
+
+#endif
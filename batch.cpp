@@ -0,0 +1,188 @@
+/*
+	Batch mode: analyze many relations in one process, either one file per
+  relation or a stream of records. Relations are processed on a work
+  stealing thread pool and their reports are printed in input order as
+  soon as every earlier report is done.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "relational.h"
+#include "threadpool.h"
+
+using namespace std;
+
+//Expands a batch specification into a list of files: the regular files of
+//a directory (sorted by name), the matches of a glob pattern, or the paths
+//listed one per line in a manifest file (blank lines and lines starting
+//with # are skipped)
+vector<string> listBatchInputs(const string &spec) {
+
+  vector<string> files;
+  struct stat info;
+
+  if(spec.find_first_of("*?[") != string::npos) {
+    glob_t matches;
+    if(glob(spec.c_str(), 0, NULL, &matches) == 0) {
+      for(size_t i = 0; i<matches.gl_pathc; i++) {
+        if(stat(matches.gl_pathv[i], &info) == 0 && S_ISREG(info.st_mode)) {
+          files.push_back(matches.gl_pathv[i]);
+        }
+      }
+    }
+    globfree(&matches);
+    return files;
+  }
+
+  if(stat(spec.c_str(), &info) != 0) return files;
+
+  if(S_ISDIR(info.st_mode)) {
+    DIR *dir = opendir(spec.c_str());
+    if(dir == NULL) return files;
+    while(struct dirent *entry = readdir(dir)) {
+      string name = entry->d_name;
+      if(name.empty() || name[0] == '.') continue;
+      string path = spec + "/" + name;
+      if(stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+        files.push_back(path);
+      }
+    }
+    closedir(dir);
+    sort(files.begin(), files.end());
+    return files;
+  }
+
+  ifstream manifest(spec);
+  string line;
+  while(getline(manifest, line)) {
+    line.erase(0, line.find_first_not_of(" \t\r"));
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if(line.empty() || line[0] == '#') continue;
+    files.push_back(line);
+  }
+  return files;
+}
+
+struct PendingReport {
+  string header;
+  string text;
+  bool done;
+  bool failed;
+};
+
+//Runs the jobs handed out by nextJob on a thread pool and prints their
+//reports in order, each preceded by a "=== <header>" line in text format
+//(JSON reports carry their own name). At most a few jobs per thread are in
+//flight, so memory stays bounded however many jobs there are. Returns 1 if
+//any job failed.
+static int runInOrder(const function<bool(string &, function<bool(ostream &)> &)> &nextJob, const ToolOptions &options, ostream &out) {
+
+  WorkStealingPool pool(options.threads);
+  size_t window = 4 * pool.size();
+  deque<shared_ptr<PendingReport>> inflight;
+  mutex lock;
+  condition_variable reportReady;
+  int status = 0;
+
+  auto emitOldest = [&] {
+    shared_ptr<PendingReport> report = inflight.front();
+    inflight.pop_front();
+    {
+      unique_lock<mutex> guard(lock);
+      reportReady.wait(guard, [&] { return report->done; });
+    }
+    if(report->failed) status = 1;
+    if(options.format == FORMAT_TEXT) out<<"=== "<<report->header<<"\n";
+    out<<report->text;
+  };
+
+  string header;
+  function<bool(ostream &)> job;
+  while(nextJob(header, job)) {
+    if(inflight.size() >= window) emitOldest();
+
+    shared_ptr<PendingReport> report(new PendingReport());
+    report->header = header;
+    report->done = false;
+    report->failed = false;
+    inflight.push_back(report);
+
+    pool.submit([report, job, &lock, &reportReady] {
+      ostringstream text;
+      bool ok = job(text);
+      lock_guard<mutex> guard(lock);
+      report->text = text.str();
+      report->failed = !ok;
+      report->done = true;
+      reportReady.notify_all();
+    });
+  }
+
+  while(!inflight.empty()) emitOldest();
+  out.flush();
+  pool.wait();
+  return status;
+}
+
+//Relations already run concurrently, so each one is analyzed on one thread
+static ToolOptions singleThreaded(const ToolOptions &options) {
+  ToolOptions perRelation = options;
+  perRelation.threads = 1;
+  return perRelation;
+}
+
+//Analyzes every file, reporting them in the order given
+int runBatch(const vector<string> &files, const ToolOptions &options, ostream &out) {
+
+  ToolOptions perRelation = singleThreaded(options);
+  size_t next = 0;
+  return runInOrder([&](string &header, function<bool(ostream &)> &job) {
+    if(next == files.size()) return false;
+    string file = files[next++];
+    header = file;
+    job = [file, &perRelation](ostream &report) {
+      RelationInput input;
+      if(!readRelationFile(file, input)) {
+        AnalysisResult failed;
+        failed.name = file;
+        failed.ok = false;
+        failed.error = "File failed to open";
+        if(perRelation.format == FORMAT_JSON) {
+          writeJSONResult(failed, perRelation, report);
+        } else {
+          writeTextResult(failed, perRelation, report);
+        }
+        return false;
+      }
+      return analyzeRelation(input, file, perRelation, report);
+    };
+    return true;
+  }, options, out);
+}
+
+//Analyzes every record of a multi-relation stream. Each record is handed
+//to the pool as soon as it has been read.
+int runStream(RelationReader &reader, const ToolOptions &options, ostream &out) {
+
+  ToolOptions perRelation = singleThreaded(options);
+  return runInOrder([&](string &header, function<bool(ostream &)> &job) {
+    shared_ptr<RelationInput> input(new RelationInput());
+    if(!reader.next(header, *input)) return false;
+    job = [input, header, &perRelation](ostream &report) {
+      return analyzeRelation(*input, header, perRelation, report);
+    };
+    return true;
+  }, options, out);
+}
@@ -0,0 +1,417 @@
+/*
+	Benchmarks for the normalization library. A seeded generator builds a
+  synthetic relation (attribute and FD counts, LHS sizes, decompositions
+  and the shape of the FDs are all parameters) and every phase of the
+  tools is timed on it separately: parsing, closure, minimal cover,
+  adding and removing FDs, key finding, the lossless join tests and the 3NF / BCNF decompositions.
+  Each phase reports its time per run, the heap allocations it made and
+  the peak resident set size of the process so far.
+*/
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <set>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <sys/resource.h>
+#include "relational.h"
+
+using namespace std;
+
+//Every heap allocation of the process goes through these counters
+static atomic<long> allocations(0);
+static atomic<long> allocatedBytes(0);
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, memory_order_relaxed);
+  allocatedBytes.fetch_add(size, memory_order_relaxed);
+  void *p = malloc(size ? size : 1);
+  if(p == NULL) throw bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+//Kept out of line so that the compiler does not pair free with new
+__attribute__((noinline)) static void release(void *p) {
+  free(p);
+}
+
+void operator delete(void *p) noexcept {
+  release(p);
+}
+
+void operator delete[](void *p) noexcept {
+  release(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  release(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+  release(p);
+}
+
+enum Topology { TOPOLOGY_RANDOM, TOPOLOGY_CHAIN, TOPOLOGY_STAR };
+
+struct SchemaOptions {
+  int attributes;
+  int fds;
+  int minLHS;
+  int maxLHS;
+  bool skewedLHS;
+  int decompositions;
+  Topology topology;
+  unsigned seed;
+};
+
+//Size of an LHS: uniform in [minLHS, maxLHS], or, when skewed, halving in
+//probability with every extra attribute
+static int pickLHSSize(const SchemaOptions &options, mt19937 &random) {
+  int span = options.maxLHS - options.minLHS;
+  if(!options.skewedLHS) return options.minLHS + random() % (span + 1);
+  int size = options.minLHS;
+  while(size < options.maxLHS && random() % 2 == 0) size++;
+  return size;
+}
+
+static string attributeName(int i) {
+  ostringstream name;
+  name<<"A"<<setw(4)<<setfill('0')<<i;
+  return name.str();
+}
+
+//Generates a relation in the text format the tools read.
+//random: LHS and RHS attributes are drawn uniformly.
+//chain:  FD i has attribute i mod n in its LHS and determines the next one.
+//star:   a hub of maxLHS attributes determines every other attribute; the
+//        remaining FDs are random among the others.
+static string generateSchema(const SchemaOptions &options) {
+
+  mt19937 random(options.seed);
+  int n = options.attributes;
+  ostringstream text;
+
+  for(int i = 0; i<n; i++) {
+    text<<(i ? "," : "")<<attributeName(i);
+  }
+  text<<endl;
+
+  //Every attribute goes into one or two fragments
+  if(options.decompositions > 0) {
+    vector<set<int>> fragments(options.decompositions);
+    for(int i = 0; i<n; i++) {
+      fragments[random() % fragments.size()].insert(i);
+      if(random() % 4 == 0) fragments[random() % fragments.size()].insert(i);
+    }
+    for(auto &fragment: fragments) {
+      if(fragment.empty()) fragment.insert(random() % n);
+      bool first = true;
+      for(int attr: fragment) {
+        text<<(first ? "" : ",")<<attributeName(attr);
+        first = false;
+      }
+      text<<endl;
+    }
+  }
+
+  int hub = min(options.maxLHS, n - 1);
+  for(int k = 0; k<options.fds; k++) {
+    set<int> lhs;
+    int rhs;
+    if(options.topology == TOPOLOGY_CHAIN) {
+      lhs.insert(k % n);
+      rhs = (k + 1) % n;
+    } else if(options.topology == TOPOLOGY_STAR && k < n - hub) {
+      for(int i = 0; i<hub; i++) lhs.insert(i);
+      rhs = hub + k;
+    } else {
+      rhs = random() % n;
+    }
+
+    int size = pickLHSSize(options, random);
+    int from = options.topology == TOPOLOGY_STAR ? hub : 0;
+    while((int)lhs.size() < size && (int)lhs.size() < n - from - 1) {
+      int attr = from + random() % (n - from);
+      if(attr != rhs) lhs.insert(attr);
+    }
+
+    bool first = true;
+    for(int attr: lhs) {
+      text<<(first ? "" : ",")<<attributeName(attr);
+      first = false;
+    }
+    text<<"->"<<attributeName(rhs)<<endl;
+  }
+
+  return text.str();
+}
+
+static long peakRSSKilobytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+//Runs body repeat times and prints one line of the report
+static void runPhase(const string &name, int repeat, const function<long()> &body) {
+
+  long result = 0;
+  double best = 0, total = 0;
+  long allocationsBefore = allocations, bytesBefore = allocatedBytes;
+
+  for(int i = 0; i<repeat; i++) {
+    auto start = chrono::steady_clock::now();
+    {
+      RelationArena arena;
+      result += body();
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    total += ms;
+    if(i == 0 || ms < best) best = ms;
+  }
+
+  long runAllocations = (allocations - allocationsBefore) / repeat;
+  long runBytes = (allocatedBytes - bytesBefore) / repeat;
+  cout<<left<<setw(12)<<name<<right<<fixed<<setprecision(3)
+      <<setw(12)<<total / repeat<<setw(12)<<best
+      <<setw(12)<<runAllocations<<setw(14)<<runBytes
+      <<setw(12)<<peakRSSKilobytes()<<setw(12)<<result / repeat<<endl;
+}
+
+static int usage() {
+  cout<<"Usage: ./bench [options]"<<endl;
+  cout<<"  --attrs N         attributes (default 64)"<<endl;
+  cout<<"  --fds N           functional dependencies (default 128)"<<endl;
+  cout<<"  --lhs MIN-MAX     LHS sizes (default 1-3)"<<endl;
+  cout<<"  --skewed          favour small LHS sizes instead of a uniform spread"<<endl;
+  cout<<"  --decomps N       fragments for the lossless join phases (default 4)"<<endl;
+  cout<<"  --topology T      random (default), chain or star"<<endl;
+  cout<<"  --seed S          generator seed (default 1)"<<endl;
+  cout<<"  --repeat N        runs per phase (default 5)"<<endl;
+  cout<<"  --phases LIST     comma separated phases to run (default all but bcnf):"<<endl;
+  cout<<"                    parse,closure,minimize,addfd,removefd,findkey,keys,lossless,"<<endl;
+  cout<<"                    chase,3nf,bcnf-poly,bcnf"<<endl;
+  cout<<"  --emit            print the generated relation instead of benchmarking"<<endl;
+  return 1;
+}
+
+int main(int argc, char **argv) {
+
+  SchemaOptions options;
+  options.attributes = 64;
+  options.fds = 128;
+  options.minLHS = 1;
+  options.maxLHS = 3;
+  options.skewedLHS = false;
+  options.decompositions = 4;
+  options.topology = TOPOLOGY_RANDOM;
+  options.seed = 1;
+  int repeat = 5;
+  bool emit = false;
+  string phases = "parse,closure,minimize,addfd,removefd,findkey,keys,lossless,chase,3nf,bcnf-poly";
+
+  for(int i = 1; i<argc; i++) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if(arg == "--attrs" && hasValue) {
+      options.attributes = atoi(argv[++i]);
+    } else if(arg == "--fds" && hasValue) {
+      options.fds = atoi(argv[++i]);
+    } else if(arg == "--lhs" && hasValue) {
+      if(sscanf(argv[++i], "%d-%d", &options.minLHS, &options.maxLHS) != 2) return usage();
+    } else if(arg == "--skewed") {
+      options.skewedLHS = true;
+    } else if(arg == "--decomps" && hasValue) {
+      options.decompositions = atoi(argv[++i]);
+    } else if(arg == "--topology" && hasValue) {
+      string topology = argv[++i];
+      if(topology == "random") {
+        options.topology = TOPOLOGY_RANDOM;
+      } else if(topology == "chain") {
+        options.topology = TOPOLOGY_CHAIN;
+      } else if(topology == "star") {
+        options.topology = TOPOLOGY_STAR;
+      } else {
+        return usage();
+      }
+    } else if(arg == "--seed" && hasValue) {
+      options.seed = strtoul(argv[++i], NULL, 10);
+    } else if(arg == "--repeat" && hasValue) {
+      repeat = atoi(argv[++i]);
+    } else if(arg == "--phases" && hasValue) {
+      phases = argv[++i];
+    } else if(arg == "--emit") {
+      emit = true;
+    } else {
+      return usage();
+    }
+  }
+  if(options.attributes < 2 || options.fds < 0 || options.minLHS < 0 || options.maxLHS < options.minLHS
+     || options.decompositions < 0 || repeat < 1) {
+    return usage();
+  }
+
+  string text = generateSchema(options);
+  if(emit) {
+    cout<<text;
+    return 0;
+  }
+
+  set<string> selected;
+  stringstream list(phases);
+  string phase;
+  while(getline(list, phase, ',')) {
+    selected.insert(phase);
+  }
+
+  RelationInput input;
+  parseRelationText(text, input);
+  const AttrSet &attrs = input.attributes;
+
+  //Caching would hide the cost of repeated runs
+  setClosureCacheCapacity(0);
+
+  cout<<"attributes "<<options.attributes<<", fds "<<options.fds<<", lhs "<<options.minLHS<<"-"<<options.maxLHS
+      <<(options.skewedLHS ? " skewed" : "")<<", decompositions "<<options.decompositions
+      <<", seed "<<options.seed<<", closure kernel "<<closureKernelName()<<endl;
+  cout<<left<<setw(12)<<"phase"<<right<<setw(12)<<"mean ms"<<setw(12)<<"best ms"
+      <<setw(12)<<"allocs"<<setw(14)<<"bytes"<<setw(12)<<"peak KB"<<setw(12)<<"result"<<endl;
+
+  Relation *r = NULL;
+  try {
+    r = new Relation(input);
+  } catch(const RelationError &e) {
+    cout<<e.what()<<endl;
+    return 1;
+  }
+  const FDSet &cover = r->getFDS();
+
+  if(selected.count("parse")) {
+    runPhase("parse", repeat, [&] {
+      RelationInput parsed;
+      parseRelationText(text, parsed);
+      return (long)parsed.fds.size();
+    });
+  }
+
+  if(selected.count("closure")) {
+    //The same 1000 pseudo-random sets of one to three attributes every run
+    vector<AttrSet> probes;
+    mt19937 random(options.seed);
+    for(int i = 0; i<1000; i++) {
+      AttrSet X;
+      int size = 1 + random() % 3;
+      for(int k = 0; k<size; k++) X.insert(random() % options.attributes);
+      probes.push_back(X);
+    }
+    ClosureEngine engine(input.fds);
+    runPhase("closure", repeat, [&] {
+      long total = 0;
+      for(auto &X: probes) total += engine.getClosure(X).count();
+      return total;
+    });
+  }
+
+  if(selected.count("minimize")) {
+    runPhase("minimize", repeat, [&] {
+      FDSet fds = input.fds;
+      minimize(fds);
+      return (long)fds.size();
+    });
+  }
+
+  //Ten edits per run on a copy of the relation, against one full minimize
+  //above. removeFD rebuilds the cover from the declared FDs left, addFD
+  //only reduces the FDs the new one can affect.
+  if(selected.count("addfd") || selected.count("removefd")) {
+    vector<FD> declared(r->getDeclaredFDs().begin(), r->getDeclaredFDs().end());
+    vector<FD> edits;
+    for(int i = 0; i<10 && !declared.empty(); i++) {
+      edits.push_back(declared[(size_t)i * declared.size() / 10]);
+    }
+    if(selected.count("removefd")) {
+      runPhase("removefd", repeat, [&] {
+        Relation edited = *r;
+        long removed = 0;
+        for(auto &dep: edits) removed += edited.removeFD(dep);
+        return removed;
+      });
+    }
+    if(selected.count("addfd")) {
+      Relation reduced = *r;
+      for(auto &dep: edits) reduced.removeFD(dep);
+      runPhase("addfd", repeat, [&] {
+        Relation edited = reduced;
+        long added = 0;
+        for(auto &dep: edits) added += edited.addFD(dep);
+        return added;
+      });
+    }
+  }
+
+  if(selected.count("findkey")) {
+    runPhase("findkey", repeat, [&] {
+      return (long)findKey(cover, attrs).count();
+    });
+  }
+
+  if(selected.count("keys")) {
+    //Stops after 1000 keys; schemas can have exponentially many
+    runPhase("keys", repeat, [&] {
+      long found = 0;
+      enumerateKeys(cover, attrs, [&](const AttrSet &) {
+        return ++found < 1000;
+      });
+      return found;
+    });
+  }
+
+  if(selected.count("lossless")) {
+    runPhase("lossless", repeat, [&] {
+      vector<pair<AttrSet,AttrSet>> joins;
+      return (long)testJoinBySplits(input.decompositions, attrs, cover, joins);
+    });
+  }
+
+  if(selected.count("chase")) {
+    runPhase("chase", repeat, [&] {
+      s_matrix s(input.decompositions, attrs, input.dictionary);
+      s.chase(cover);
+      return (long)s.hasAtypeRow();
+    });
+  }
+
+  if(selected.count("3nf")) {
+    runPhase("3nf", repeat, [&] {
+      return (long)synthesize3NF(*r).size();
+    });
+  }
+
+  if(selected.count("bcnf-poly")) {
+    runPhase("bcnf-poly", repeat, [&] {
+      return (long)decomposeBCNFPolynomial(*r).size();
+    });
+  }
+
+  //Projecting FDs can take exponential time, so this one is opt-in
+  if(selected.count("bcnf")) {
+    runPhase("bcnf", repeat, [&] {
+      return (long)decomposeBCNF(*r).size();
+    });
+  }
+
+  delete r;
+  return 0;
+}
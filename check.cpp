@@ -0,0 +1,1932 @@
+/*
+	Regression checks for the normalization library, run by make check.
+  Each check builds small relations (from relation text or from a table)
+  and compares what the library computes against a direct computation.
+  Prints every failed check and exits with 1 if there was any.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <ftw.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void expect(bool condition, const string &what) {
+  if(!condition) {
+    cout<<"FAILED: "<<what<<endl;
+    failures++;
+  }
+}
+
+static RelationInput parseText(const string &text) {
+  RelationInput input;
+  parseRelationText(text, input);
+  return input;
+}
+
+static AttrSet attrsOf(const RelationInput &input, const string &names) {
+  AttrSet s;
+  for(char c: names) {
+    s.insert(input.dictionary.find(string(1, c)));
+  }
+  return s;
+}
+
+//Whether key determines every attribute and no attribute of it can go
+static bool isKey(const FDSet &fdset, const AttrSet &attributes, const AttrSet &key) {
+  if(getClosure(key, attributes, fdset) != attributes) return false;
+  for(int attr: key) {
+    AttrSet smaller = key;
+    smaller.erase(attr);
+    if(getClosure(smaller, attributes, fdset) == attributes) return false;
+  }
+  return true;
+}
+
+//Whether two FD sets over attributes (at most 16) have the same closures
+static bool equivalent(const FDSet &a, const FDSet &b, const AttrSet &attributes) {
+  vector<int> ids;
+  for(int attr: attributes) {
+    ids.push_back(attr);
+  }
+  for(unsigned mask = 0; mask < (1u << ids.size()); mask++) {
+    AttrSet X;
+    for(int i = 0; i<(int)ids.size(); i++) {
+      if(mask >> i & 1) X.insert(ids[i]);
+    }
+    if(getClosure(X, attributes, a) != getClosure(X, attributes, b)) return false;
+  }
+  return true;
+}
+
+//Names of generated attributes: letters for up to 26, A0, A1, ... beyond
+static string attrName(int i, int n) {
+  return n <= 26 ? string(1, (char)('A' + i)) : "A" + to_string(i);
+}
+
+//A random relation over n attributes with up to fds FDs, each with one to
+//maxLHS attributes on the left and one or two on the right
+static string randomRelationText(mt19937 &rng, int n, int fds, int maxLHS) {
+  string text;
+  for(int i = 0; i<n; i++) {
+    text += (i ? "," : "") + attrName(i, n);
+  }
+  text += "\n";
+  for(int k = rng() % (fds + 1); k > 0; k--) {
+    string lhs, rhs;
+    for(int size = 1 + rng() % maxLHS; size > 0; size--) {
+      lhs += (lhs.empty() ? "" : ",") + attrName(rng() % n, n);
+    }
+    for(int size = 1 + rng() % 2; size > 0; size--) {
+      rhs += (rhs.empty() ? "" : ",") + attrName(rng() % n, n);
+    }
+    text += lhs + "->" + rhs + "\n";
+  }
+  return text;
+}
+
+//A random subset of attributes, each in it with probability 1 / spread
+static AttrSet randomSubset(mt19937 &rng, const AttrSet &attributes, int spread) {
+  AttrSet X;
+  for(int attr: attributes) {
+    if(rng() % spread == 0) X.insert(attr);
+  }
+  return X;
+}
+
+//The closure by the textbook fixpoint: apply FDs until none adds anything
+static AttrSet naiveClosure(const AttrSet &X, const FDSet &fdset) {
+  AttrSet closure = X;
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(auto &dep: fdset) {
+      if(dep.first.isSubsetOf(closure) && !dep.second.isSubsetOf(closure)) {
+        closure |= dep.second;
+        changed = true;
+      }
+    }
+  }
+  return closure;
+}
+
+//The sections of testcases/answers.txt: the file each is for, the tool
+//named in its title, and its lines
+struct Answer {
+  string file;
+  string title;
+  vector<string> lines;
+};
+
+static vector<Answer> readAnswers() {
+  vector<Answer> answers;
+  MappedFile file("testcases/answers.txt");
+  if(!file.isOpen()) return answers;
+  string text(file.getText());
+  size_t pos = 0;
+  bool inside = false;
+  while(pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if(end == string::npos) end = text.size();
+    string line = text.substr(pos, end - pos);
+    pos = end + 1;
+    if(line.compare(0, 3, "---") == 0) {
+      inside = !inside;
+      if(inside) answers.push_back(Answer());
+    } else if(inside && answers.back().file.empty()) {
+      size_t dash = line.find(" - ");
+      answers.back().file = line.substr(0, dash);
+      answers.back().title = dash == string::npos ? "" : line.substr(dash + 3);
+    } else if(inside) {
+      answers.back().lines.push_back(line);
+    }
+  }
+  return answers;
+}
+
+//A fragment written as space separated names, upper-cased like the parser
+static set<string> namesOf(const string &line) {
+  set<string> names;
+  string name;
+  for(char c: line + " ") {
+    if(c == ' ') {
+      if(!name.empty()) names.insert(name);
+      name.clear();
+    } else {
+      name.push_back(toupper((unsigned char)c));
+    }
+  }
+  return names;
+}
+
+//A new empty directory under /tmp, removed again by removeDirectory
+static string makeTemporaryDirectory() {
+  char path[] = "/tmp/relational-check-XXXXXX";
+  return mkdtemp(path) ? path : "";
+}
+
+static void removeDirectory(const string &path) {
+  nftw(path.c_str(), [](const char *file, const struct stat *, int, struct FTW *) {
+    return remove(file);
+  }, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static void writeFile(const string &path, const string &text) {
+  ofstream out(path, ios::binary);
+  out<<text;
+}
+
+static ToolOptions defaultOptions(Operation op) {
+  ToolOptions options;
+  options.op = op;
+  options.forceTableau = false;
+  options.strategy = BCNF_PROJECTION;
+  options.printTree = false;
+  options.format = FORMAT_TEXT;
+  options.quiet = false;
+  options.threads = 1;
+  return options;
+}
+
+//Whether fdset is a minimal cover: no FD follows from the others and no
+//LHS attribute (down to an empty LHS) is extraneous
+static bool isMinimal(const FDSet &fdset, const AttrSet &attributes) {
+  for(auto &dep: fdset) {
+    FDSet others = fdset;
+    others.erase(dep);
+    if(dep.second.isSubsetOf(getClosure(dep.first, attributes, others))) return false;
+    for(int attr: dep.first) {
+      AttrSet smaller = dep.first;
+      smaller.erase(attr);
+      if(dep.second.isSubsetOf(getClosure(smaller, attributes, fdset))) return false;
+    }
+  }
+  return true;
+}
+
+//AttrSet against std::set<int> under random edits, with ids past the
+//inline words so that sets spill to the heap and shrink back
+static void checkAttrSet() {
+  mt19937 rng(5);
+  for(int round = 0; round<2000; round++) {
+    int range = (round % 4 == 0) ? 700 : 200;
+    AttrSet a, b;
+    set<int> ma, mb;
+    for(int k = rng() % 40; k > 0; k--) {
+      int id = rng() % range;
+      if(rng() % 4 == 0) {
+        a.erase(id);
+        ma.erase(id);
+      } else {
+        a.insert(id);
+        ma.insert(id);
+      }
+      id = rng() % range;
+      b.insert(id);
+      mb.insert(id);
+    }
+    auto model = [](const AttrSet &s) {
+      set<int> ids;
+      for(int id: s) {
+        ids.insert(id);
+      }
+      return ids;
+    };
+    set<int> expected;
+    expect(model(a) == ma && model(b) == mb, "AttrSet iterates its members in order");
+    expect(a.count() == (int)ma.size() && a.empty() == ma.empty(), "AttrSet count and empty");
+    expect(a.contains(range - 1) == (ma.count(range - 1) == 1) && !a.contains(range + 64), "AttrSet contains");
+
+    expected.clear();
+    set_union(ma.begin(), ma.end(), mb.begin(), mb.end(), inserter(expected, expected.end()));
+    expect(model(a | b) == expected, "AttrSet union");
+    expected.clear();
+    set_intersection(ma.begin(), ma.end(), mb.begin(), mb.end(), inserter(expected, expected.end()));
+    expect(model(a & b) == expected && model(b & a) == expected, "AttrSet intersection");
+    expect(a.intersects(b) == !expected.empty(), "AttrSet intersects");
+    expected.clear();
+    set_difference(ma.begin(), ma.end(), mb.begin(), mb.end(), inserter(expected, expected.end()));
+    expect(model(a - b) == expected, "AttrSet difference");
+    expect(a.isSubsetOf(b) == includes(mb.begin(), mb.end(), ma.begin(), ma.end()), "AttrSet isSubsetOf");
+
+    //Equal sets compare and hash equal however many words they hold
+    AttrSet c = a | b;
+    c -= b;
+    expect((c == (a - b)) && c.hash() == (a - b).hash(), "AttrSet equality ignores spare words");
+    expect((a < b) == (ma < mb) && (b < a) == (mb < ma), "AttrSet orders like std::set<int>");
+    expect((a == b) == (ma == mb), "AttrSet equality");
+
+    uint64_t words[4] = {rng(), 0, (uint64_t)rng() << 32, 0};
+    AttrSet w = a;
+    w.insertWords(words, 4);
+    set<int> mw = ma;
+    for(int i = 0; i<256; i++) {
+      if(words[i / 64] >> (i % 64) & 1) mw.insert(i);
+    }
+    expect(model(w) == mw, "AttrSet insertWords");
+  }
+
+  //Ids follow name order after sortByName, and sets decode to names
+  AttributeDictionary dictionary;
+  for(string name: {"SALARY", "DNO", "EMP_SSN", "ADDRESS", "DNO"}) {
+    dictionary.intern(name);
+  }
+  dictionary.sortByName();
+  expect(dictionary.size() == 4 && dictionary.find("ADDRESS") == 0 && dictionary.find("SALARY") == 3, "dictionary ids follow name order");
+  expect(dictionary.find("NAME") == -1, "dictionary find of an unknown name");
+  set<string> names = {"DNO", "SALARY"};
+  expect(dictionary.decode(dictionary.encode(names)) == names, "dictionary encode and decode");
+}
+
+//Runs the testcases through the library entry point the three tools
+//share and compares the results with testcases/answers.txt
+static void checkTestcases() {
+  vector<Answer> answers = readAnswers();
+  expect(answers.size() >= 10, "testcases/answers.txt has the expected answers");
+  for(auto &answer: answers) {
+    ToolOptions options = defaultOptions(OP_LJ);
+    options.quiet = true;
+    if(answer.title.find("LJ test") != string::npos) {
+      options.op = OP_LJ;
+    } else if(answer.title.find("3NF") != string::npos) {
+      options.op = OP_3NF;
+    } else if(answer.title.find("BCNF") != string::npos) {
+      options.op = OP_BCNF;
+    } else {
+      continue;
+    }
+
+    RelationInput input;
+    string what = answer.file + " (" + answer.title + ")";
+    if(!readRelationFile("testcases/" + answer.file, input)) {
+      expect(false, what + ": file can be read");
+      continue;
+    }
+    AnalysisResult result = computeResult(input, answer.file, options);
+    expect(result.ok, what + ": analysis succeeds");
+    if(options.op == OP_LJ) {
+      bool lossless = !answer.lines.empty() && answer.lines[0] == "true";
+      expect(result.verdict == (lossless ? JOIN_LOSSLESS : JOIN_LOSSY), what + ": lossless join verdict");
+    } else {
+      set<set<string>> expected, found;
+      for(auto &line: answer.lines) {
+        if(!namesOf(line).empty()) expected.insert(namesOf(line));
+      }
+      for(auto &fragment: result.decompositions) {
+        found.insert(result.dictionary.decode(fragment));
+      }
+      expect(found == expected, what + ": fragments");
+    }
+  }
+}
+
+//Closures from getClosure and from an engine with FDs skipped or disabled
+//against the fixpoint, on relations small, within the 256 attributes of
+//the kernel and wider (LinClosure)
+static void checkClosure() {
+  mt19937 rng(4);
+  for(int n: {6, 40, 200, 300}) {
+    for(int round = 0; round<60; round++) {
+      RelationInput input = parseText(randomRelationText(rng, n, 3 * n, 3));
+      vector<FD> fds(input.fds.begin(), input.fds.end());
+      ClosureEngine engine(fds);
+      for(int probe = 0; probe<20; probe++) {
+        AttrSet X = randomSubset(rng, input.attributes, n / 3 + 1);
+        string what = "closure over " + to_string(n) + " attributes";
+        expect(getClosure(X, input.attributes, input.fds) == naiveClosure(X, input.fds), what);
+        if(fds.empty()) continue;
+
+        int skip = rng() % fds.size();
+        FDSet others = input.fds;
+        others.erase(fds[skip]);
+        expect(engine.getClosure(X, skip) == naiveClosure(X, others), what + ", one FD skipped");
+
+        int off = rng() % fds.size();
+        engine.setEnabled(off, false);
+        FDSet enabled = input.fds;
+        enabled.erase(fds[off]);
+        expect(engine.getClosure(X) == naiveClosure(X, enabled), what + ", one FD disabled");
+        engine.setEnabled(off, true);
+      }
+    }
+  }
+  expect(getClosure(AttrSet(), AttrSet(), FDSet()).empty(), "closure of the empty set without FDs");
+}
+
+//minimize must give a minimal cover with one attribute on every RHS that
+//is equivalent to the FDs it started from, including FDs with an empty LHS
+static void checkMinimize() {
+  mt19937 rng(6);
+  for(int round = 0; round<1000; round++) {
+    int n = 2 + rng() % 7;
+    AttrSet attributes;
+    for(int i = 0; i<n; i++) {
+      attributes.insert(i);
+    }
+    FDSet fdset;
+    for(int k = rng() % 12; k > 0; k--) {
+      AttrSet X = randomSubset(rng, attributes, round % 5 == 0 ? 4 : 3);
+      AttrSet Y = randomSubset(rng, attributes, 3);
+      if(!Y.empty()) fdset.insert(make_pair(X, Y));
+    }
+    FDSet cover = fdset;
+    minimize(cover);
+    bool single = true;
+    for(auto &dep: cover) {
+      if(dep.second.count() != 1 || dep.first.contains(*dep.second.begin())) single = false;
+    }
+    expect(single, "minimize: one attribute, not on the LHS, on every RHS");
+    expect(equivalent(cover, fdset, attributes), "minimize: cover equivalent to the FDs");
+    expect(isMinimal(cover, attributes), "minimize: cover is minimal");
+  }
+}
+
+//A random decomposition into at most fragments parts covering every
+//attribute, some attributes shared by two parts
+static set<AttrSet> randomDecomposition(mt19937 &rng, const AttrSet &attributes, int fragments) {
+  vector<AttrSet> parts(fragments);
+  for(int attr: attributes) {
+    parts[rng() % fragments].insert(attr);
+    if(rng() % 3 == 0) parts[rng() % fragments].insert(attr);
+  }
+  set<AttrSet> decomposition;
+  for(auto &part: parts) {
+    if(!part.empty()) decomposition.insert(part);
+  }
+  return decomposition;
+}
+
+//Whether a binary decomposition is lossless by the textbook criterion:
+//the common attributes determine one of the two fragments
+static bool binaryLossless(const AttrSet &R1, const AttrSet &R2, const AttrSet &attributes, const FDSet &fdset) {
+  AttrSet closure = getClosure(R1 & R2, attributes, fdset);
+  return R1.isSubsetOf(closure) || R2.isSubsetOf(closure);
+}
+
+//The initial S matrix distinguishes exactly the attributes of each
+//fragment; the chase of a binary decomposition agrees with the textbook
+//criterion; and a chase that found no distinguished row has stopped at a
+//tableau satisfying every FD
+static void checkChase() {
+  mt19937 rng(7);
+  for(int round = 0; round<1000; round++) {
+    int n = 2 + rng() % 7;
+    RelationInput input = parseText(randomRelationText(rng, n, 6, 2));
+    Relation r(input);
+    set<AttrSet> decomposition = randomDecomposition(rng, r.getAttributes(), round % 2 ? 2 : 2 + rng() % 3);
+
+    s_matrix initial(decomposition, r.getAttributes(), r.getDictionary());
+    bool marked = initial.getRows() == (int)decomposition.size() && initial.getColumns() == n;
+    int row = 0;
+    for(auto &fragment: decomposition) {
+      int column = 0;
+      for(int attr: r.getAttributes()) {
+        if((initial.cellName(row, column)[0] == 'a') != fragment.contains(attr)) marked = false;
+        column++;
+      }
+      row++;
+    }
+    expect(marked, "chase: initial tableau distinguishes the fragments");
+
+    s_matrix s(decomposition, r.getAttributes(), r.getDictionary());
+    s.chase(r.getFDS());
+    if(decomposition.size() == 2) {
+      expect(s.hasAtypeRow() == binaryLossless(*decomposition.begin(), *decomposition.rbegin(), r.getAttributes(), r.getFDS()), "chase: binary decomposition verdict");
+    }
+    if(s.hasAtypeRow()) continue;
+
+    bool satisfied = true;
+    vector<int> columnOf(r.getDictionary().size());
+    int column = 0;
+    for(int attr: r.getAttributes()) {
+      columnOf[attr] = column++;
+    }
+    for(auto &dep: r.getFDS()) {
+      for(int i = 0; i<s.getRows(); i++) {
+        for(int j = i + 1; j<s.getRows(); j++) {
+          bool agree = true;
+          for(int attr: dep.first) {
+            if(s.cellName(i, columnOf[attr]) != s.cellName(j, columnOf[attr])) agree = false;
+          }
+          if(!agree) continue;
+          for(int attr: dep.second) {
+            if(s.cellName(i, columnOf[attr]) != s.cellName(j, columnOf[attr])) satisfied = false;
+          }
+        }
+      }
+    }
+    expect(satisfied, "chase: a finished chase satisfies every FD");
+  }
+}
+
+//Verdicts from joining fragments two at a time must agree with the chase
+//whenever they decide; binary decompositions and split trees are always
+//decided, and the reported joins must replay to the whole relation
+static void checkSplits() {
+  mt19937 rng(8);
+  for(int round = 0; round<1000; round++) {
+    int n = 2 + rng() % 7;
+    RelationInput input = parseText(randomRelationText(rng, n, 6, 2));
+    Relation r(input);
+    const AttrSet &attributes = r.getAttributes();
+    set<AttrSet> decomposition = randomDecomposition(rng, attributes, 2 + rng() % 4);
+    if(round % 10 == 0) {
+      //An attribute in no fragment
+      AttrSet dropped = *decomposition.begin();
+      decomposition.erase(decomposition.begin());
+      dropped.erase(*attributes.begin());
+      for(auto &fragment: decomposition) {
+        dropped -= fragment;
+      }
+      if(!dropped.empty()) decomposition.insert(dropped);
+    }
+
+    vector<pair<AttrSet,AttrSet>> joins;
+    JoinTest verdict = testJoinBySplits(decomposition, attributes, r.getFDS(), joins);
+    s_matrix s(decomposition, attributes, r.getDictionary());
+    s.chase(r.getFDS());
+    if(decomposition.size() <= 2) expect(verdict != JOIN_UNDECIDED, "splits: binary decompositions are decided");
+    if(verdict != JOIN_UNDECIDED) expect((verdict == JOIN_LOSSLESS) == s.hasAtypeRow(), "splits: verdict agrees with the chase");
+
+    if(verdict == JOIN_LOSSLESS) {
+      set<AttrSet> fragments = decomposition;
+      bool replayed = true;
+      for(auto &join: joins) {
+        if(!fragments.count(join.first) || !fragments.count(join.second) || !binaryLossless(join.first, join.second, attributes, r.getFDS())) replayed = false;
+        fragments.erase(join.first);
+        fragments.erase(join.second);
+        fragments.insert(join.first | join.second);
+      }
+      expect(replayed && fragments.count(attributes), "splits: the joins rebuild the relation");
+    }
+
+    set<AttrSet> tree = decomposeBCNFPolynomial(r);
+    joins.clear();
+    expect(testJoinBySplits(tree, attributes, r.getFDS(), joins) == JOIN_LOSSLESS, "splits: a BCNF split tree is shown lossless");
+  }
+}
+
+//Batch inputs from a directory, a glob and a manifest, and batch reports
+//in input order whatever thread finishes first
+static void checkBatch() {
+  vector<string> listed = listBatchInputs("testcases");
+  expect(is_sorted(listed.begin(), listed.end()) && count(listed.begin(), listed.end(), "testcases/ljt1.txt") == 1, "batch: a directory lists its files in name order");
+  vector<string> files = listBatchInputs("testcases/*t[0-9].txt");
+  expect(files.size() >= 10 && count(files.begin(), files.end(), "testcases/answers.txt") == 0, "batch: a glob lists its matches");
+
+  string directory = makeTemporaryDirectory();
+  writeFile(directory + "/manifest", "# test cases\n  testcases/ljt2.txt \n\ntestcases/3nft1.txt\r\n");
+  vector<string> manifest = listBatchInputs(directory + "/manifest");
+  expect(manifest == vector<string>({"testcases/ljt2.txt", "testcases/3nft1.txt"}), "batch: a manifest lists its paths");
+
+  files.push_back(directory + "/missing.txt");
+  for(OutputFormat format: {FORMAT_TEXT, FORMAT_JSON}) {
+    for(Operation op: {OP_LJ, OP_3NF, OP_BCNF}) {
+      ToolOptions options = defaultOptions(op);
+      options.format = format;
+      ostringstream expected;
+      for(auto &file: files) {
+        if(format == FORMAT_TEXT) expected<<"=== "<<file<<"\n";
+        RelationInput input;
+        if(readRelationFile(file, input)) {
+          analyzeRelation(input, file, options, expected);
+        } else {
+          AnalysisResult failed;
+          failed.name = file;
+          failed.ok = false;
+          failed.error = "File failed to open";
+          if(format == FORMAT_JSON) {
+            writeJSONResult(failed, options, expected);
+          } else {
+            writeTextResult(failed, options, expected);
+          }
+        }
+      }
+      options.threads = 4;
+      ostringstream batch;
+      int status = runBatch(files, options, batch);
+      expect(batch.str() == expected.str(), "batch: reports in input order");
+      expect(status == 1, "batch: a file that fails to open fails the batch");
+    }
+  }
+  removeDirectory(directory);
+}
+
+static bool sameRelation(const RelationInput &a, const RelationInput &b) {
+  return a.attributes == b.attributes && a.fds == b.fds && a.decompositions == b.decompositions && a.dictionary.size() == b.dictionary.size();
+}
+
+//Several relations in one input, read back one record at a time from
+//memory and from a stream, and the reports of runStream
+static void checkStream() {
+  mt19937 rng(9);
+  for(int trial = 0; trial<100; trial++) {
+    int count = rng() % 6 + 1;
+    vector<string> names, records;
+    string text = rng() % 2 ? "\n \n" : "";
+    for(int i = 0; i<count; i++) {
+      bool named = rng() % 2;
+      //A header also ends the record before it
+      if(i > 0 && !(named && rng() % 2)) text += rng() % 2 ? "\n" : " \t\r\n\n";
+      if(named) {
+        names.push_back("r" + to_string(trial) + "_" + to_string(i));
+        text += rng() % 2 ? "# " + names.back() + " \n" : "#" + names.back() + "\r\n";
+      } else {
+        names.push_back("relation " + to_string(i + 1));
+      }
+      records.push_back(randomRelationText(rng, rng() % 8 + 2, rng() % 10, 3));
+      text += records.back();
+    }
+
+    for(int source = 0; source<2; source++) {
+      istringstream in(text);
+      RelationReader fromText{string_view(text)};
+      RelationReader fromStream(in);
+      RelationReader &reader = source == 0 ? fromText : fromStream;
+      string name;
+      RelationInput input;
+      int i = 0;
+      while(i < count && reader.next(name, input)) {
+        expect(name == names[i], "stream: record " + to_string(i + 1) + " is called " + names[i]);
+        expect(sameRelation(input, parseText(records[i])), "stream: record " + to_string(i + 1) + " parses as on its own");
+        i++;
+      }
+      expect(i == count && !reader.next(name, input), "stream: every record is read");
+    }
+
+    for(Operation op: {OP_LJ, OP_3NF, OP_BCNF}) {
+      ToolOptions options = defaultOptions(op);
+      ostringstream expected;
+      for(int i = 0; i<count; i++) {
+        expected<<"=== "<<names[i]<<"\n";
+        analyzeRelation(parseText(records[i]), names[i], options, expected);
+      }
+      options.threads = 3;
+      RelationReader reader{string_view(text)};
+      ostringstream stream;
+      runStream(reader, options, stream);
+      expect(stream.str() == expected.str(), "stream: reports in record order");
+    }
+  }
+
+  MappedFile catalog("testcases/catalog.txt");
+  RelationReader reader(catalog.getText());
+  string name;
+  RelationInput input;
+  vector<string> names;
+  while(reader.next(name, input)) names.push_back(name);
+  expect(names == vector<string>({"enrollment", "abcd", "emp_proj"}), "stream: testcases/catalog.txt holds three named relations");
+}
+
+//A relation as the original line-by-line parser read it, by name
+struct NamedRelation {
+  set<string> attributes;
+  set<set<string>> decompositions;
+  set<pair<set<string>, set<string>>> fds;
+};
+
+static set<string> splitNames(const string &list) {
+  set<string> names;
+  stringstream ss(list);
+  while(ss.good()) {
+    string name;
+    getline(ss, name, ',');
+    names.insert(name);
+  }
+  return names;
+}
+
+static NamedRelation referenceParse(const string &text) {
+  NamedRelation r;
+  istringstream in(text);
+  string line;
+  bool first = true;
+  while(getline(in, line)) {
+    string clean;
+    for(char c: line) {
+      if(c != ' ' && c != '\t' && c != '\r') clean.push_back(toupper((unsigned char)c));
+    }
+    if(first) {
+      r.attributes = splitNames(clean);
+      first = false;
+    } else if(clean.find('-') != string::npos) {
+      clean.erase(remove(clean.begin(), clean.end(), '>'), clean.end());
+      stringstream ss(clean);
+      string lhs, rhs;
+      getline(ss, lhs, '-');
+      getline(ss, rhs, '-');
+      r.fds.insert(make_pair(splitNames(lhs), splitNames(rhs)));
+    } else {
+      r.decompositions.insert(splitNames(clean));
+    }
+  }
+  return r;
+}
+
+static NamedRelation named(const RelationInput &input) {
+  NamedRelation r;
+  r.attributes = input.dictionary.decode(input.attributes);
+  for(auto &fragment: input.decompositions) {
+    r.decompositions.insert(input.dictionary.decode(fragment));
+  }
+  for(auto &fd: input.fds) {
+    r.fds.insert(make_pair(input.dictionary.decode(fd.first), input.dictionary.decode(fd.second)));
+  }
+  return r;
+}
+
+//The mapped in-place parser against the original line-by-line reading,
+//on files with mixed case, spaces, tabs, CRLF lines and no final newline
+static void checkParser() {
+  mt19937 rng(10);
+  string directory = makeTemporaryDirectory();
+  string file = directory + "/relation.txt";
+  for(int trial = 0; trial<300; trial++) {
+    int n = rng() % 10 + 2;
+    string text = randomRelationText(rng, n, 12, 3);
+    for(int k = rng() % 3; k > 0; k--) {
+      string fragment;
+      for(int size = 1 + rng() % n; size > 0; size--) {
+        fragment += (fragment.empty() ? "" : ",") + attrName(rng() % n, n);
+      }
+      text += fragment + "\n";
+    }
+    string noisy;
+    for(char c: text) {
+      if(c == '\n') {
+        noisy += rng() % 3 ? "\n" : "\r\n";
+      } else if(c == ',' || c == '-') {
+        noisy += string(rng() % 2, ' ') + c + string(rng() % 2, '\t');
+      } else {
+        noisy.push_back(rng() % 2 ? tolower(c) : c);
+      }
+    }
+    if(rng() % 2) noisy.erase(noisy.find_last_not_of("\r\n") + 1);
+
+    writeFile(file, noisy);
+    RelationInput input;
+    expect(readRelationFile(file, input), "parser: a written file opens");
+    NamedRelation expected = referenceParse(noisy), parsed = named(input);
+    expect(parsed.attributes == expected.attributes, "parser: attributes as read line by line");
+    expect(parsed.decompositions == expected.decompositions, "parser: decompositions as read line by line");
+    expect(parsed.fds == expected.fds, "parser: FDs as read line by line");
+
+    vector<string> ordered(parsed.attributes.begin(), parsed.attributes.end());
+    bool sorted = true;
+    for(int id = 0; id<(int)ordered.size(); id++) {
+      sorted = sorted && input.dictionary.getName(id) == ordered[id];
+    }
+    expect(sorted, "parser: attribute ids follow name order");
+  }
+
+  RelationInput input;
+  expect(!readRelationFile(directory + "/missing.txt", input), "parser: a missing file fails to open");
+  expect(!readRelationFile(directory, input), "parser: a directory fails to open");
+  writeFile(file, "");
+  expect(readRelationFile(file, input), "parser: an empty file opens");
+  removeDirectory(directory);
+}
+
+//Projections of F onto random fragments against the definition: every
+//subset X of the fragment determines closure(X) within the fragment
+static void checkProjection() {
+  mt19937 rng(11);
+  for(int trial = 0; trial<300; trial++) {
+    int n = rng() % 9 + 2;
+    RelationInput input = parseText(randomRelationText(rng, n, 2 * n, 3));
+    minimize(input.fds);
+    ProjectionEngine engine(input.fds);
+    for(int probe = 0; probe<4; probe++) {
+      AttrSet fragment = randomSubset(rng, input.attributes, 2);
+      vector<int> ids;
+      for(int attr: fragment) {
+        ids.push_back(attr);
+      }
+      FDSet expected;
+      for(int mask = 0; mask<(1 << ids.size()); mask++) {
+        AttrSet X;
+        for(int i = 0; i<(int)ids.size(); i++) {
+          if(mask >> i & 1) X.insert(ids[i]);
+        }
+        AttrSet Y = naiveClosure(X, input.fds);
+        Y &= fragment;
+        if(Y != X) expected.insert(make_pair(X, Y));
+      }
+
+      FDSet projected = engine.project(fragment);
+      AttrSet used;
+      for(auto &fd: projected) {
+        used |= fd.first;
+        used |= fd.second;
+      }
+      expect(used.isSubsetOf(fragment), "projection: FDs stay inside the fragment");
+      expect(equivalent(projected, expected, fragment), "projection: equivalent to the projection by definition");
+      expect(isMinimal(projected, fragment), "projection: a minimal cover");
+      expect(engine.project(fragment) == projected, "projection: a cached projection is unchanged");
+    }
+  }
+}
+
+//Whether every fragment is in BCNF under fdset: any subset of it that
+//determines another of its attributes determines all of them
+static bool inBCNF(const set<AttrSet> &fragments, const FDSet &fdset, const AttrSet &attributes) {
+  for(auto &fragment: fragments) {
+    vector<int> ids;
+    for(int attr: fragment) {
+      ids.push_back(attr);
+    }
+    for(unsigned mask = 0; mask < (1u << ids.size()); mask++) {
+      AttrSet X;
+      for(int i = 0; i<(int)ids.size(); i++) {
+        if(mask >> i & 1) X.insert(ids[i]);
+      }
+      AttrSet closure = getClosure(X, attributes, fdset);
+      if(!(closure & fragment).isSubsetOf(X) && !fragment.isSubsetOf(closure)) return false;
+    }
+  }
+  return true;
+}
+
+//Both BCNF strategies on random relations: fragments in BCNF that cover
+//the relation and join losslessly by the chase
+static void checkBCNF() {
+  mt19937 rng(12);
+  for(int trial = 0; trial<300; trial++) {
+    int n = rng() % 9 + 2;
+    Relation r(parseText(randomRelationText(rng, n, 2 * n, 3)));
+    for(int polynomial = 0; polynomial<2; polynomial++) {
+      string what = polynomial ? "BCNF (polynomial)" : "BCNF (projection)";
+      set<AttrSet> fragments = polynomial ? decomposeBCNFPolynomial(r) : decomposeBCNF(r);
+      AttrSet covered;
+      for(auto &fragment: fragments) {
+        covered |= fragment;
+      }
+      expect(covered == r.getAttributes(), what + ": fragments cover the relation");
+      expect(inBCNF(fragments, r.getFDS(), r.getAttributes()), what + ": fragments are in BCNF");
+      s_matrix s(fragments, r.getAttributes(), r.getDictionary());
+      s.chase(r.getFDS());
+      expect(s.hasAtypeRow(), what + ": the chase finds the join lossless");
+    }
+    expect(getTreeLeaves(buildBCNFTreePolynomial(r)) == decomposeBCNFPolynomial(r), "BCNF (polynomial): the tree leaves are the decomposition");
+  }
+}
+
+//Split trees built on one thread and on four: every inner node splits its
+//fragment on an FD X -> Y that holds in it, into fragment - Y and XY, and
+//the leaves do not depend on the number of threads
+static void checkBCNFTree() {
+  mt19937 rng(13);
+  for(int trial = 0; trial<60; trial++) {
+    int n = trial % 2 ? rng() % 8 + 2 : rng() % 4 + 16;
+    Relation r(parseText(randomRelationText(rng, n, n, 2)));
+    vector<BCNFNode> tree = buildBCNFTree(r, 1);
+    expect(tree[0].fragment == r.getAttributes(), "BCNF tree: the root is the relation");
+    for(auto &node: tree) {
+      if(node.left < 0) continue;
+      const AttrSet &X = node.split.first, &Y = node.split.second;
+      AttrSet closure = getClosure(X, r.getAttributes(), r.getFDS());
+      expect((X | Y).isSubsetOf(node.fragment) && Y.isSubsetOf(closure), "BCNF tree: the split FD holds in the fragment");
+      expect(!node.fragment.isSubsetOf(closure), "BCNF tree: the split LHS is not a key of the fragment");
+      expect(tree[node.left].fragment == node.fragment - Y && tree[node.right].fragment == (X | Y), "BCNF tree: children are fragment - Y and XY");
+    }
+    set<AttrSet> leaves = getTreeLeaves(tree);
+    expect(leaves == decomposeBCNF(r), "BCNF tree: the leaves are the decomposition");
+    expect(getTreeLeaves(buildBCNFTree(r, 4)) == leaves, "BCNF tree: four threads give the same leaves");
+  }
+}
+
+//3NF synthesis on random relations, some with dozens of fragments:
+//no fragment lies inside another, every FD of the cover lies inside one,
+//one holds a key, and the join is lossless by the chase
+static void checkSynthesis() {
+  mt19937 rng(14);
+  for(int trial = 0; trial<300; trial++) {
+    int n = trial % 10 ? rng() % 10 + 2 : rng() % 40 + 20;
+    Relation r(parseText(randomRelationText(rng, n, 4 * n, 3)));
+    set<AttrSet> fragments = synthesize3NF(r);
+
+    bool contained = false, key = false;
+    for(auto &a: fragments) {
+      for(auto &b: fragments) {
+        if(a != b && a.isSubsetOf(b)) contained = true;
+      }
+      if(getClosure(a, r.getAttributes(), r.getFDS()) == r.getAttributes()) key = true;
+    }
+    expect(!contained, "3NF: no fragment lies inside another");
+    expect(key, "3NF: a fragment holds a key");
+    for(auto &fd: r.getFDS()) {
+      bool preserved = false;
+      for(auto &fragment: fragments) {
+        if((fd.first | fd.second).isSubsetOf(fragment)) preserved = true;
+      }
+      expect(preserved, "3NF: every FD of the cover lies inside a fragment");
+    }
+    s_matrix s(fragments, r.getAttributes(), r.getDictionary());
+    s.chase(r.getFDS());
+    expect(s.hasAtypeRow(), "3NF: the chase finds the join lossless");
+  }
+}
+
+//Closures through the per-thread cache, at the default capacity, a tiny
+//one that evicts all the time and none at all, while the engine's FDs are
+//edited under it; and least recently used eviction
+static void checkClosureCache() {
+  mt19937 rng(15);
+  for(size_t capacity: {(size_t)4096, (size_t)3, (size_t)0}) {
+    setClosureCacheCapacity(capacity);
+    ClosureCacheStats before = getClosureCacheStats();
+    for(int trial = 0; trial<40; trial++) {
+      //Engines under 64 FDs do not use the cache
+      int n = rng() % 30 + 20;
+      RelationInput input = parseText(randomRelationText(rng, n, 8 * n, 3));
+      vector<FD> fds(input.fds.begin(), input.fds.end());
+      ClosureEngine engine(fds);
+      vector<bool> on(fds.size(), true);
+      for(int probe = 0; probe<40; probe++) {
+        if(probe % 10 == 9 && !fds.empty()) {
+          //Disable an FD, or narrow its LHS to one attribute
+          int i = rng() % fds.size();
+          if(rng() % 2 && !fds[i].first.empty()) {
+            AttrSet X;
+            X.insert(*fds[i].first.begin());
+            engine.setLHS(i, X);
+            fds[i].first = X;
+          } else {
+            engine.setEnabled(i, false);
+            on[i] = false;
+          }
+        }
+        FDSet enabled;
+        for(size_t i = 0; i<fds.size(); i++) {
+          if(on[i]) enabled.insert(fds[i]);
+        }
+        AttrSet X = randomSubset(rng, input.attributes, 3);
+        for(int repeat = 0; repeat<2; repeat++) {
+          expect(engine.getClosure(X) == naiveClosure(X, enabled), "closure cache: closure with capacity " + to_string(capacity));
+          X.insert(rng() % n);
+        }
+      }
+    }
+    ClosureCacheStats after = getClosureCacheStats();
+    if(capacity == 0) {
+      expect(after.hits == before.hits && after.subsetHits == before.subsetHits && after.misses == before.misses, "closure cache: a disabled cache is not consulted");
+    } else {
+      expect(after.hits + after.subsetHits > before.hits + before.subsetHits, "closure cache: repeated closures hit");
+    }
+  }
+  setClosureCacheCapacity(4096);
+
+  ClosureCache cache(2);
+  AttrSet a, b, c, closure, seed;
+  a.insert(1);
+  b.insert(20);
+  c.insert(300);
+  cache.insert(7, a, a | b);
+  cache.insert(7, b, b);
+  expect(cache.lookupClosure(7, a, closure, seed) && closure == (a | b), "closure cache: a stored closure is found");
+  expect(!cache.lookupClosure(8, a, closure, seed), "closure cache: another version misses");
+  cache.insert(7, c, c);
+  expect(!cache.lookupClosure(7, b, closure, seed), "closure cache: the least recently used entry is evicted");
+  expect(cache.lookupClosure(7, a, closure, seed) && cache.lookupClosure(7, c, closure, seed), "closure cache: recently used entries stay");
+  expect(cache.lookupClosure(7, a | c, closure, seed) == false && seed == (a | b | c), "closure cache: a miss is seeded from cached subsets");
+}
+
+//Every kernel the CPU supports closes the same sets to the same closures
+//as a naive fixpoint, over one to four words, with FDs skipped, disabled
+//and in blocks that leave padding lanes
+static void checkKernels() {
+  string original = closureKernelName();
+  mt19937 rng(16);
+  for(string name: {"scalar", "avx2", "avx512"}) {
+    if(!selectClosureKernel(name)) {
+      cout<<"Skipping the "<<name<<" kernel, which this CPU does not support"<<endl;
+      continue;
+    }
+    expect(closureKernelName() == name, "kernel: " + name + " is selected");
+    for(int n: {5, 64, 65, 130, 256}) {
+      for(int round = 0; round<40; round++) {
+        RelationInput input = parseText(randomRelationText(rng, n, 2 * n + round % FDColumns::FD_BLOCK, 3));
+        vector<FD> fds(input.fds.begin(), input.fds.end());
+        int words = (n + 63) / 64;
+        FDColumns columns;
+        columns.reset(fds.size(), words);
+        FDSet enabled;
+        for(size_t i = 0; i<fds.size(); i++) {
+          columns.setLHS(i, fds[i].first);
+          //Every fifth FD is disabled
+          columns.setRHS(i, i % 5 == 4 ? AttrSet() : fds[i].second);
+          if(i % 5 != 4) enabled.insert(fds[i]);
+        }
+        for(int probe = 0; probe<10; probe++) {
+          AttrSet X = randomSubset(rng, input.attributes, n / 4 + 1);
+          int skip = fds.empty() || probe % 2 ? -1 : rng() % fds.size();
+          FDSet used = enabled;
+          if(skip >= 0) used.erase(fds[skip]);
+          uint64_t closure[4];
+          for(int w = 0; w<words; w++) {
+            closure[w] = X.word(w);
+          }
+          closeOverColumns(columns, closure, skip);
+          AttrSet Xp;
+          Xp.insertWords(closure, words);
+          expect(Xp == naiveClosure(X, used), "kernel: " + name + " closure over " + to_string(n) + " attributes");
+        }
+      }
+    }
+  }
+  selectClosureKernel(original);
+}
+
+//Runs command and returns what it printed; status is its exit status
+static string runCommand(const string &command, int &status) {
+  string output;
+  FILE *pipe = popen(command.c_str(), "r");
+  if(pipe == NULL) {
+    status = -1;
+    return output;
+  }
+  char buffer[4096];
+  size_t length;
+  while((length = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+    output.append(buffer, length);
+  }
+  int result = pclose(pipe);
+  status = WIFEXITED(result) ? WEXITSTATUS(result) : -1;
+  return output;
+}
+
+//The benchmark's schema generator, through ./bench --emit: the requested
+//numbers of attributes, fragments and FDs, LHS sizes in range, the shape
+//of each topology, and the same relation for the same seed. Every phase
+//then runs once on a small relation of each topology.
+static void checkBench() {
+  for(string topology: {"random", "chain", "star"}) {
+    for(int seed = 1; seed<=3; seed++) {
+      string command = "./bench --emit --attrs 20 --fds 40 --lhs 2-4 --decomps 3 --topology " + topology + " --seed " + to_string(seed);
+      int status;
+      string text = runCommand(command, status);
+      expect(status == 0 && runCommand(command, status) == text, "bench: " + topology + " schemas are repeatable");
+
+      istringstream lines(text);
+      string line;
+      int fragments = 0, k = 0;
+      bool shaped = true;
+      getline(lines, line);
+      RelationInput input = parseText(text);
+      expect(input.attributes.count() == 20, "bench: " + topology + " schemas have the requested attributes");
+      while(getline(lines, line)) {
+        size_t arrow = line.find("->");
+        if(arrow == string::npos) {
+          fragments++;
+          continue;
+        }
+        set<string> lhs = splitNames(line.substr(0, arrow));
+        string rhs = line.substr(arrow + 2);
+        if(topology == "chain") {
+          char from[8], to[8];
+          snprintf(from, sizeof(from), "A%04d", k % 20);
+          snprintf(to, sizeof(to), "A%04d", (k + 1) % 20);
+          shaped = shaped && lhs.count(from) && rhs == to;
+        } else if(topology == "star" && k < 20 - 4) {
+          shaped = shaped && lhs == set<string>({"A0000", "A0001", "A0002", "A0003"});
+        }
+        shaped = shaped && lhs.size() >= 2 && lhs.size() <= 4 && !lhs.count(rhs);
+        k++;
+      }
+      expect(fragments == 3 && input.decompositions.size() <= 3, "bench: " + topology + " schemas have the requested fragments");
+      expect(k == 40, "bench: " + topology + " schemas have the requested FDs");
+      expect(shaped, "bench: " + topology + " FDs have the requested shape");
+    }
+
+    int status;
+    string report = runCommand("./bench --attrs 16 --fds 24 --repeat 1 --topology " + topology
+      + " --phases parse,closure,minimize,addfd,removefd,findkey,keys,lossless,chase,3nf,bcnf-poly,bcnf", status);
+    bool ran = status == 0;
+    for(string phase: {"parse", "closure", "minimize", "addfd", "removefd", "findkey", "keys", "lossless", "chase", "3nf", "bcnf-poly", "bcnf"}) {
+      ran = ran && report.find("\n" + phase + " ") != string::npos;
+    }
+    expect(ran, "bench: every phase runs on a " + topology + " schema");
+  }
+}
+
+//Every sample of a Prometheus exposition by name and labels; false if a
+//line is malformed or a metric lacks its HELP and TYPE lines
+static bool readPrometheus(const string &text, map<string, double> &samples) {
+  istringstream lines(text);
+  string line;
+  set<string> described, typed;
+  while(getline(lines, line)) {
+    istringstream fields(line);
+    string first, name;
+    if(line.compare(0, 7, "# HELP ") == 0 || line.compare(0, 7, "# TYPE ") == 0) {
+      fields>>first>>first>>name;
+      (line[2] == 'H' ? described : typed).insert(name);
+      continue;
+    }
+    double value;
+    if(!(fields>>name>>value) || !fields.eof()) return false;
+    string metric = name.substr(0, name.find('{'));
+    if(!described.count(metric) || !typed.count(metric)) return false;
+    samples[name] = value;
+  }
+  return true;
+}
+
+//The statistics report in both formats, and, in a make STATS=1 build,
+//counters that follow the work done between two reports
+static void checkStats() {
+  ostringstream json, prometheus;
+  printStats(json, false);
+  printStats(prometheus, true);
+  map<string, double> before;
+  expect(readPrometheus(prometheus.str(), before), "stats: the Prometheus report is well formed");
+  expect(before.count("relational_phase_calls_total{phase=\"parse\"}") && before.count("relational_relations_total")
+    && before.count("relational_closure_cache_total{result=\"miss\"}"), "stats: the Prometheus report has every metric");
+  string text = json.str();
+  expect(count(text.begin(), text.end(), '{') == count(text.begin(), text.end(), '}') && text.back() == '\n'
+    && text.find("\"closure_kernel\": \"" + string(closureKernelName()) + "\"") != string::npos, "stats: the JSON report is one object");
+
+  ToolOptions options = defaultOptions(OP_3NF);
+  for(int i = 0; i<5; i++) {
+    ostringstream out;
+    RelationInput input;
+    readRelationFile("testcases/3nft" + to_string(i % 4 + 1) + ".txt", input);
+    analyzeRelation(input, "3nf", options, out);
+  }
+  ostringstream again;
+  printStats(again, true);
+  map<string, double> after;
+  expect(readPrometheus(again.str(), after), "stats: the Prometheus report is well formed");
+  double relations = after["relational_relations_total"] - before["relational_relations_total"];
+  double parses = after["relational_phase_calls_total{phase=\"parse\"}"] - before["relational_phase_calls_total{phase=\"parse\"}"];
+  double closures = after["relational_closures_total"] - before["relational_closures_total"];
+  if(statsCompiledIn()) {
+    expect(relations == 5 && parses == 5 && closures > 0, "stats: counters follow the work done");
+  } else {
+    expect(relations == 0 && parses == 0 && closures == 0, "stats: counters stay at zero without make STATS=1");
+  }
+}
+
+//Skips one JSON value starting at s[i]; false if it is malformed. A
+//string value is decoded into text when text is given.
+static bool skipJSON(const string &s, size_t &i, string *text = NULL) {
+  if(i >= s.size()) return false;
+  char c = s[i];
+  if(c == '{' || c == '[') {
+    char close = c == '{' ? '}' : ']';
+    i++;
+    if(i < s.size() && s[i] == close) {
+      i++;
+      return true;
+    }
+    while(true) {
+      if(c == '{') {
+        if(i >= s.size() || s[i] != '"' || !skipJSON(s, i) || i >= s.size() || s[i++] != ':') return false;
+      }
+      if(!skipJSON(s, i) || i >= s.size()) return false;
+      if(s[i] == close) {
+        i++;
+        return true;
+      }
+      if(s[i++] != ',') return false;
+    }
+  }
+  if(c == '"') {
+    string decoded;
+    for(i++; i<s.size() && s[i] != '"'; i++) {
+      if((unsigned char)s[i] < 0x20) return false;
+      if(s[i] != '\\') {
+        decoded.push_back(s[i]);
+      } else if(i + 1 < s.size() && (s[i + 1] == '"' || s[i + 1] == '\\')) {
+        decoded.push_back(s[++i]);
+      } else if(i + 5 < s.size() && s.compare(i + 1, 3, "u00") == 0 && isxdigit(s[i + 4]) && isxdigit(s[i + 5])) {
+        decoded.push_back((char)stoi(s.substr(i + 4, 2), NULL, 16));
+        i += 5;
+      } else {
+        return false;
+      }
+    }
+    if(i >= s.size()) return false;
+    i++;
+    if(text != NULL) *text = decoded;
+    return true;
+  }
+  for(string word: {"true", "false", "null"}) {
+    if(s.compare(i, word.size(), word) == 0) {
+      i += word.size();
+      return true;
+    }
+  }
+  size_t start = i;
+  while(i < s.size() && (isdigit(s[i]) || s[i] == '-' || s[i] == '.' || s[i] == 'e' || s[i] == '+')) i++;
+  return i > start;
+}
+
+//Every report as one well formed JSON line, with the relation name
+//escaped, and quiet text reports that keep only the answer
+static void checkReports() {
+  mt19937 rng(19);
+  const string names[] = {"plain", "with \"quotes\"", "back\\slash", "tab\there", "line\nbreak", "\x01\x1f"};
+  for(int trial = 0; trial<200; trial++) {
+    int n = rng() % 8 + 2;
+    RelationInput input = parseText(randomRelationText(rng, n, 2 * n, 3));
+    input.decompositions = randomDecomposition(rng, input.attributes, 2 + rng() % 3);
+    string name = names[trial % 6];
+    for(Operation op: {OP_LJ, OP_3NF, OP_BCNF}) {
+      ToolOptions options = defaultOptions(op);
+      options.forceTableau = trial % 2;
+      options.printTree = trial % 3 == 0;
+      options.strategy = trial % 4 == 0 ? BCNF_POLYNOMIAL : BCNF_PROJECTION;
+      AnalysisResult result = computeResult(input, name, options);
+      if(trial % 50 == 0) {
+        result.ok = false;
+        result.error = "ERROR: \"" + name + "\"";
+      }
+      for(int quiet = 0; quiet<2; quiet++) {
+        options.quiet = quiet;
+        ostringstream json;
+        writeJSONResult(result, options, json);
+        string line = json.str();
+        size_t i = 0, at = 8;
+        string decoded;
+        expect(skipJSON(line, i) && i + 1 == line.size() && line.back() == '\n', "report: one well formed JSON object per line");
+        expect(line.compare(0, 8, "{\"name\":") == 0 && skipJSON(line, at, &decoded) && decoded == name, "report: the name is escaped");
+      }
+
+      ostringstream verbose, quiet;
+      options.quiet = false;
+      writeTextResult(result, options, verbose);
+      options.quiet = true;
+      writeTextResult(result, options, quiet);
+      string full = verbose.str(), answer = quiet.str();
+      if(!result.ok) {
+        expect(answer == result.error + "\n" && full == answer, "report: an error is reported alone");
+      } else if(op == OP_LJ) {
+        expect((answer == "SATISFIES LJ\n" || answer == "FAILS LJ\n") && full.find("---------------\n" + answer) != string::npos, "report: quiet LJ reports keep the verdict");
+      } else {
+        expect(answer.find("Decomposition") != string::npos && full.find("---------------\n" + answer) != string::npos, "report: quiet decompositions keep the fragments");
+      }
+    }
+  }
+}
+
+//Arenas nest and are per thread, and analyses run inside one, nested or
+//large enough to outgrow its inline buffer, give the results they give
+//on the heap
+static void checkArena() {
+  expect(RelationArena::current() == pmr::new_delete_resource(), "arena: the heap outside any arena");
+  {
+    RelationArena outer;
+    pmr::memory_resource *first = RelationArena::current();
+    expect(first != pmr::new_delete_resource(), "arena: an arena replaces the heap");
+    {
+      RelationArena inner;
+      expect(RelationArena::current() != first, "arena: the innermost arena is current");
+      pmr::memory_resource *other = NULL;
+      thread([&other] { other = RelationArena::current(); }).join();
+      expect(other == pmr::new_delete_resource(), "arena: other threads keep the heap");
+    }
+    expect(RelationArena::current() == first, "arena: the outer arena is current again");
+  }
+  expect(RelationArena::current() == pmr::new_delete_resource(), "arena: the heap again after the last arena");
+
+  mt19937 rng(20);
+  for(int trial = 0; trial<200; trial++) {
+    int n = trial % 10 ? rng() % 10 + 2 : rng() % 100 + 100;
+    RelationInput input = parseText(randomRelationText(rng, n, 2 * n, 3));
+    input.decompositions = randomDecomposition(rng, input.attributes, 2 + rng() % 4);
+    Relation r(input);
+    set<AttrSet> synthesized = synthesize3NF(r);
+    vector<pair<AttrSet,AttrSet>> joins;
+    JoinTest verdict = testJoinBySplits(input.decompositions, r.getAttributes(), r.getFDS(), joins);
+    s_matrix s(input.decompositions, r.getAttributes(), r.getDictionary());
+    s.chase(r.getFDS());
+    set<AttrSet> bcnf;
+    if(n <= 12) bcnf = decomposeBCNF(r);
+
+    RelationArena arena;
+    for(int depth = 0; depth<2; depth++) {
+      RelationArena nested;
+      Relation inside(input);
+      expect(inside.getFDS() == r.getFDS() && inside.getKey() == r.getKey(), "arena: the same cover and key inside an arena");
+      expect(synthesize3NF(inside) == synthesized, "arena: the same 3NF decomposition inside an arena");
+      vector<pair<AttrSet,AttrSet>> insideJoins;
+      expect(testJoinBySplits(input.decompositions, inside.getAttributes(), inside.getFDS(), insideJoins) == verdict && insideJoins == joins, "arena: the same split verdict inside an arena");
+      s_matrix t(input.decompositions, inside.getAttributes(), inside.getDictionary());
+      t.chase(inside.getFDS());
+      expect(t.hasAtypeRow() == s.hasAtypeRow(), "arena: the same chase verdict inside an arena");
+      if(n <= 12) expect(decomposeBCNF(inside) == bcnf, "arena: the same BCNF decomposition inside an arena");
+    }
+  }
+}
+
+//The chase done naively: every FD is applied to every pair of rows until
+//nothing changes. Symbol 0 is distinguished.
+static vector<vector<int>> naiveChase(const set<AttrSet> &decomposition, const AttrSet &attributes, const FDSet &fdset) {
+  map<int, int> columnOf;
+  vector<vector<int>> tableau;
+  int column = 0, next = 1;
+  for(int attr: attributes) {
+    columnOf[attr] = column++;
+  }
+  for(auto &fragment: decomposition) {
+    vector<int> row;
+    for(int attr: attributes) {
+      row.push_back(fragment.contains(attr) ? 0 : next++);
+    }
+    tableau.push_back(row);
+  }
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(auto &dep: fdset) {
+      for(auto &a: tableau) {
+        for(auto &b: tableau) {
+          bool agree = true;
+          for(int attr: dep.first) {
+            agree = agree && a[columnOf[attr]] == b[columnOf[attr]];
+          }
+          if(!agree) continue;
+          for(int attr: dep.second) {
+            int from = max(a[columnOf[attr]], b[columnOf[attr]]), to = min(a[columnOf[attr]], b[columnOf[attr]]);
+            if(from == to) continue;
+            for(auto &row: tableau) {
+              if(row[columnOf[attr]] == from) row[columnOf[attr]] = to;
+            }
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+  return tableau;
+}
+
+//The semi-naive chase against the naive one on decompositions of up to
+//eight fragments: the same verdict and, when no row is distinguished,
+//the same tableau up to the names of the symbols
+static void checkSemiNaiveChase() {
+  mt19937 rng(21);
+  for(int trial = 0; trial<1000; trial++) {
+    int n = rng() % 10 + 2;
+    Relation r(parseText(randomRelationText(rng, n, 2 * n, 3)));
+    set<AttrSet> decomposition = randomDecomposition(rng, r.getAttributes(), 2 + rng() % 7);
+    vector<vector<int>> expected = naiveChase(decomposition, r.getAttributes(), r.getFDS());
+    s_matrix s(decomposition, r.getAttributes(), r.getDictionary());
+    s.chase(r.getFDS());
+
+    bool lossless = false;
+    for(auto &row: expected) {
+      if(count(row.begin(), row.end(), 0) == (int)row.size()) lossless = true;
+    }
+    expect(s.hasAtypeRow() == lossless, "semi-naive chase: the naive verdict");
+    if(lossless) continue;
+
+    bool same = s.getRows() == (int)expected.size();
+    for(int c = 0; same && c<s.getColumns(); c++) {
+      for(int i = 0; i<s.getRows(); i++) {
+        same = same && (s.cellName(i, c)[0] == 'a') == (expected[i][c] == 0);
+        for(int j = 0; j<i; j++) {
+          same = same && (s.cellName(i, c) == s.cellName(j, c)) == (expected[i][c] == expected[j][c]);
+        }
+      }
+    }
+    expect(same, "semi-naive chase: the naive tableau");
+  }
+}
+
+//A client connection to a server socket: whole requests out, one
+//framed response ("ok" or "error", the body length, then the body) in
+struct ServerClient {
+  int fd;
+  string buffer;
+
+  ServerClient(const string &path) {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    //The server thread may not be listening yet
+    for(int attempt = 0; attempt<200; attempt++) {
+      if(connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) return;
+      usleep(10000);
+    }
+    close(fd);
+    fd = -1;
+  }
+
+  ~ServerClient() {
+    if(fd >= 0) close(fd);
+  }
+
+  void send(const string &data) {
+    size_t written = 0;
+    while(fd >= 0 && written < data.size()) {
+      ssize_t n = write(fd, data.data() + written, data.size() - written);
+      if(n <= 0) return;
+      written += n;
+    }
+  }
+
+  bool fill() {
+    char chunk[4096];
+    ssize_t n = fd < 0 ? 0 : read(fd, chunk, sizeof(chunk));
+    if(n <= 0) return false;
+    buffer.append(chunk, n);
+    return true;
+  }
+
+  //False at the end of the connection
+  bool receive(bool &ok, string &body) {
+    size_t end;
+    while((end = buffer.find('\n')) == string::npos) {
+      if(!fill()) return false;
+    }
+    istringstream header(buffer.substr(0, end));
+    string status;
+    size_t length = 0;
+    header>>status>>length;
+    ok = status == "ok";
+    while(buffer.size() < end + 1 + length) {
+      if(!fill()) return false;
+    }
+    body = buffer.substr(end + 1, length);
+    buffer.erase(0, end + 1 + length);
+    return status == "ok" || status == "error";
+  }
+};
+
+//A server on a socket answering pipelined requests in order with the
+//reports the tools print, refusing bad requests without dropping the
+//connection, counting requests in its stats, and ending a connection
+//whose last body is cut short
+static void checkServer() {
+  string directory = makeTemporaryDirectory();
+  string path = directory + "/server.sock";
+  ToolOptions defaults = defaultOptions(OP_LJ);
+  defaults.threads = 4;
+  thread([path, defaults] { runServer(path, defaults, 64); }).detach();
+
+  ServerClient client(path);
+  expect(client.fd >= 0, "server: accepts a connection");
+  mt19937 rng(22);
+  const string operations[] = {"lj", "3nf", "bcnf"};
+  string requests;
+  vector<string> expected;
+  for(int i = 0; i<60; i++) {
+    int n = rng() % 8 + 2;
+    string body = randomRelationText(rng, n, 2 * n, 3);
+    set<AttrSet> decomposition = randomDecomposition(rng, parseText(body).attributes, 2 + rng() % 3);
+    for(auto &fragment: decomposition) {
+      string line;
+      for(int attr: fragment) {
+        line += (line.empty() ? "" : ",") + attrName(attr, n);
+      }
+      body += line + "\r\n";
+    }
+    RelationInput input = parseText(body);
+
+    Operation op = (Operation)(i % 3);
+    ToolOptions options = defaultOptions(op);
+    string line = operations[i % 3];
+    if(rng() % 2) {
+      line += " json";
+      options.format = FORMAT_JSON;
+    }
+    if(rng() % 2) {
+      line += " quiet";
+      options.quiet = true;
+    }
+    if(op == OP_LJ && rng() % 2) {
+      line += " tableau";
+      options.forceTableau = true;
+    }
+    if(op == OP_BCNF && rng() % 2) {
+      line += " tree";
+      options.printTree = true;
+    }
+    if(op == OP_BCNF && rng() % 2) {
+      line += " polynomial";
+      options.strategy = BCNF_POLYNOMIAL;
+    }
+    string name = "r" + to_string(i);
+    line += " name=" + name + " " + to_string(body.size()) + (i % 5 ? "\n" : "\r\n");
+    requests += line + body;
+
+    AnalysisResult result = computeResult(input, name, options);
+    ostringstream report;
+    if(options.format == FORMAT_JSON) {
+      writeJSONResult(result, options, report);
+    } else {
+      writeTextResult(result, options, report);
+    }
+    expected.push_back(report.str());
+
+    if(i % 20 == 7) {
+      requests += "\nnormalize 3\nA,B";
+      expected.push_back("error:ERROR: unknown operation normalize\n");
+      requests += "3nf verbose 0\n";
+      expected.push_back("error:ERROR: unknown flag verbose\n");
+      requests += "lj json\n";
+      expected.push_back("error:ERROR: expected the body length at the end of the request line\n");
+    }
+  }
+  client.send(requests);
+  bool ordered = true;
+  for(auto &answer: expected) {
+    bool ok;
+    string body;
+    if(!client.receive(ok, body)) {
+      ordered = false;
+      break;
+    }
+    ordered = ordered && (answer.compare(0, 6, "error:") == 0 ? !ok && body == answer.substr(6) : ok && body == answer);
+  }
+  expect(ordered, "server: responses in request order, bad requests refused");
+
+  bool ok;
+  string body;
+  client.send("stats\n");
+  expect(client.receive(ok, body) && ok && body.find("\"requests\": " + to_string(expected.size()) + ",") != string::npos, "server: stats count every request");
+
+  client.send("3nf 100\nA,B\n");
+  shutdown(client.fd, SHUT_WR);
+  expect(client.receive(ok, body) && !ok && body == "ERROR: incomplete request body\n", "server: a cut short body is refused");
+  expect(!client.receive(ok, body), "server: the connection ends after a cut short body");
+
+  unlink(path.c_str());
+  removeDirectory(directory);
+}
+
+//The regular files under directory
+static vector<string> filesUnder(const string &directory) {
+  static vector<string> *found;
+  vector<string> files;
+  found = &files;
+  nftw(directory.c_str(), [](const char *file, const struct stat *, int type, struct FTW *) {
+    if(type == FTW_F) found->push_back(file);
+    return 0;
+  }, 16, FTW_PHYS);
+  return files;
+}
+
+static string reportOf(const AnalysisResult &result, const ToolOptions &options) {
+  ostringstream report;
+  if(options.format == FORMAT_JSON) {
+    writeJSONResult(result, options, report);
+  } else {
+    writeTextResult(result, options, report);
+  }
+  return report.str();
+}
+
+//Results stored in the disk cache and read back give the reports the
+//analysis gives; equivalent inputs share an entry while other operations
+//and options do not; and an entry that is corrupted, truncated, of
+//another version or empty is a miss that the next analysis replaces
+static void checkDiskCache() {
+  mt19937 rng(23);
+  string directory = makeTemporaryDirectory();
+  for(int trial = 0; trial<150; trial++) {
+    int n = rng() % 8 + 2;
+    RelationInput input = parseText(randomRelationText(rng, n, 2 * n, 3));
+    input.decompositions = randomDecomposition(rng, input.attributes, 2 + rng() % 3);
+    ToolOptions options = defaultOptions((Operation)(trial % 3));
+    options.format = rng() % 2 ? FORMAT_JSON : FORMAT_TEXT;
+    options.forceTableau = rng() % 2;
+    options.printTree = rng() % 2;
+    options.strategy = rng() % 2 ? BCNF_POLYNOMIAL : BCNF_PROJECTION;
+    string expected = reportOf(computeResult(input, "cached", options), options);
+
+    string entries = directory + "/" + to_string(trial);
+    options.diskCache = entries;
+    string key = resultCacheKey(input, options);
+    AnalysisResult loaded;
+    expect(!loadCachedResult(entries, key, loaded), "disk cache: an empty cache misses");
+    expect(reportOf(computeResult(input, "cached", options), options) == expected, "disk cache: a stored result is reported as computed");
+    vector<string> files = filesUnder(entries);
+    expect(files.size() == 1, "disk cache: one entry per result");
+    expect(loadCachedResult(entries, key, loaded), "disk cache: a stored result is found");
+    expect(reportOf(computeResult(input, "cached", options), options) == expected, "disk cache: a loaded result is reported as computed");
+
+    //The same relation with its FDs merged by LHS has the same key
+    RelationInput merged = input;
+    merged.fds.clear();
+    map<AttrSet, AttrSet> byLHS;
+    for(auto &fd: input.fds) {
+      byLHS[fd.first] |= fd.second;
+    }
+    merged.fds.insert(byLHS.begin(), byLHS.end());
+    expect(resultCacheKey(merged, options) == key, "disk cache: FDs merged by LHS share an entry");
+    ToolOptions other = options;
+    other.op = (Operation)((trial + 1) % 3);
+    expect(resultCacheKey(input, other) != key, "disk cache: another operation has another entry");
+
+    if(files.size() != 1) continue;
+    ifstream in(files[0], ios::binary);
+    string entry((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    string damaged = entry;
+    switch(trial % 4) {
+      case 0:
+        damaged[24 + rng() % (damaged.size() - 24)] ^= 1 << (rng() % 8);
+        break;
+      case 1:
+        damaged.resize(rng() % damaged.size());
+        break;
+      case 2:
+        damaged[4]++;
+        break;
+      default:
+        damaged.clear();
+    }
+    writeFile(files[0], damaged);
+    AnalysisResult corrupt;
+    expect(!loadCachedResult(entries, key, corrupt), "disk cache: a damaged entry misses");
+    expect(reportOf(computeResult(input, "cached", options), options) == expected, "disk cache: a damaged entry is recomputed");
+    ifstream again(files[0], ios::binary);
+    expect(string((istreambuf_iterator<char>(again)), istreambuf_iterator<char>()) == entry, "disk cache: a damaged entry is replaced");
+  }
+  removeDirectory(directory);
+}
+
+//After removeFD the relation must be the one built from what is left of
+//the declared FDs
+static void checkRemoved(const Relation &r, const string &what) {
+  RelationInput rebuilt;
+  rebuilt.dictionary = r.getDictionary();
+  rebuilt.attributes = r.getAttributes();
+  rebuilt.fds = r.getDeclaredFDs();
+  Relation expected(rebuilt);
+  expect(r.getFDS() == expected.getFDS(), what + ": cover differs from the rebuilt relation");
+  expect(isKey(r.getFDS(), r.getAttributes(), r.getKey()), what + ": key is not a key");
+}
+
+static void checkRemoveFD() {
+
+  //A -> C is declared and only left out of the cover as implied
+  RelationInput input = parseText("A,B,C\nA->B\nB->C\nA->C\n");
+  Relation r(input);
+  expect(r.removeFD(make_pair(attrsOf(input, "B"), attrsOf(input, "C"))), "removeFD(B->C) found the FD");
+  checkRemoved(r, "removeFD(B->C)");
+  expect(getClosure(attrsOf(input, "A"), r.getAttributes(), r.getFDS()).contains(input.dictionary.find("C")), "removeFD(B->C) kept A->C");
+
+  //AB -> C is declared but the cover holds A -> C instead
+  input = parseText("A,B,C\nA,B->C\nA->B\n");
+  Relation s(input);
+  expect(s.removeFD(make_pair(attrsOf(input, "AB"), attrsOf(input, "C"))), "removeFD(AB->C) found the FD");
+  checkRemoved(s, "removeFD(AB->C)");
+  expect(!getClosure(attrsOf(input, "A"), s.getAttributes(), s.getFDS()).contains(input.dictionary.find("C")), "removeFD(AB->C) dropped A->C");
+
+  expect(!s.removeFD(make_pair(attrsOf(input, "B"), attrsOf(input, "A"))), "removeFD of an undeclared FD changes nothing");
+
+  //A constant makes a single attribute LHS extraneous: {-> C, C -> B}
+  //reduces to {-> C, -> B}
+  input = parseText("A,B,C\nC->B\n");
+  Relation t(input);
+  t.addFD(make_pair(AttrSet(), attrsOf(input, "C")));
+  FDSet constants;
+  constants.insert(make_pair(AttrSet(), attrsOf(input, "B")));
+  constants.insert(make_pair(AttrSet(), attrsOf(input, "C")));
+  expect(t.getFDS() == constants, "addFD(-> C) reduces C -> B to -> B");
+
+  //Random edits: the cover must stay equivalent to the declared FDs
+  mt19937 rng(1);
+  for(int round = 0; round<2000; round++) {
+    int n = 3 + rng() % 5;
+    string text;
+    for(int i = 0; i<n; i++) {
+      text += string(i ? "," : "") + (char)('A' + i);
+    }
+    text += "\n";
+    for(int k = rng() % 8; k > 0; k--) {
+      string lhs, rhs;
+      for(int i = 0; i<n; i++) {
+        if(rng() % 3 == 0) lhs += string(lhs.empty() ? "" : ",") + (char)('A' + i);
+        if(rng() % 4 == 0) rhs += string(rhs.empty() ? "" : ",") + (char)('A' + i);
+      }
+      if(!lhs.empty() && !rhs.empty()) text += lhs + "->" + rhs + "\n";
+    }
+    input = parseText(text);
+    Relation edited(input);
+
+    for(int step = 0; step<4; step++) {
+      int op = rng() % 3;
+      if(op == 0 && !edited.getDeclaredFDs().empty()) {
+        auto itr = edited.getDeclaredFDs().begin();
+        advance(itr, rng() % edited.getDeclaredFDs().size());
+        FD dep = *itr;
+        edited.removeFD(dep);
+        checkRemoved(edited, "random removeFD");
+      } else if(op == 1) {
+        AttrSet X, Y;
+        for(int attr: edited.getAttributes()) {
+          if(rng() % 3 == 0) X.insert(attr);
+          if(rng() % 4 == 0) Y.insert(attr);
+        }
+        edited.addFD(make_pair(X, Y));
+      } else if(edited.getAttributes().count() > 2) {
+        vector<int> ids;
+        for(int attr: edited.getAttributes()) {
+          ids.push_back(attr);
+        }
+        edited.dropAttribute(edited.getDictionary().getName(ids[rng() % ids.size()]));
+      }
+      expect(equivalent(edited.getFDS(), edited.getDeclaredFDs(), edited.getAttributes()), "random edit: cover equivalent to the declared FDs");
+      expect(isKey(edited.getFDS(), edited.getAttributes(), edited.getKey()), "random edit: key is a key");
+      expect(isMinimal(edited.getFDS(), edited.getAttributes()), "random edit: cover is minimal");
+    }
+  }
+}
+
+//Every candidate key by brute force over the subsets of attributes (at
+//most 16)
+static set<AttrSet> bruteForceKeys(const FDSet &fdset, const AttrSet &attributes) {
+  vector<int> ids;
+  for(int attr: attributes) {
+    ids.push_back(attr);
+  }
+  set<AttrSet> keys;
+  for(unsigned mask = 0; mask < (1u << ids.size()); mask++) {
+    AttrSet X;
+    for(int i = 0; i<(int)ids.size(); i++) {
+      if(mask >> i & 1) X.insert(ids[i]);
+    }
+    if(isKey(fdset, attributes, X)) keys.insert(X);
+  }
+  return keys;
+}
+
+//The fixtures in testcases/ with their candidate keys (also listed in
+//testcases/answers.txt), then random relations against brute force
+static void checkKeys() {
+  vector<pair<string, vector<string>>> fixtures = {
+    {"testcases/keyst1.txt", {"AB", "BC", "BD"}},
+    {"testcases/keyst2.txt", {"AE", "BE", "CE", "DE"}},
+    {"testcases/keyst3.txt", {"AB"}},
+    {"testcases/keyst4.txt", {"P", "CL", "AL"}},
+    {"testcases/3nft4.txt", {"P", "CL", "AL"}}
+  };
+  for(auto &fixture: fixtures) {
+    RelationInput input;
+    if(!readRelationFile(fixture.first, input)) {
+      expect(false, fixture.first + " can be read");
+      continue;
+    }
+    Relation r(input);
+    set<AttrSet> expected;
+    AttrSet prime;
+    for(auto &names: fixture.second) {
+      expected.insert(attrsOf(input, names));
+      prime |= attrsOf(input, names);
+    }
+    vector<AttrSet> found = findAllKeys(r.getFDS(), r.getAttributes());
+    expect(set<AttrSet>(found.begin(), found.end()) == expected && found.size() == expected.size(), fixture.first + ": candidate keys");
+    expect(getPrimeAttributes(r.getFDS(), r.getAttributes()) == prime, fixture.first + ": prime attributes");
+    expect(findAllKeys(r.getFDS(), r.getAttributes(), 1).size() == 1, fixture.first + ": key limit");
+  }
+
+  mt19937 rng(3);
+  for(int round = 0; round<500; round++) {
+    int n = 2 + rng() % 7;
+    string text;
+    for(int i = 0; i<n; i++) {
+      text += string(i ? "," : "") + (char)('A' + i);
+    }
+    text += "\n";
+    for(int k = rng() % 10; k > 0; k--) {
+      string lhs, rhs;
+      for(int i = 0; i<n; i++) {
+        if(rng() % 3 == 0) lhs += string(lhs.empty() ? "" : ",") + (char)('A' + i);
+        if(rng() % 4 == 0) rhs += string(rhs.empty() ? "" : ",") + (char)('A' + i);
+      }
+      if(!lhs.empty() && !rhs.empty()) text += lhs + "->" + rhs + "\n";
+    }
+    RelationInput input = parseText(text);
+    Relation r(input);
+    set<AttrSet> expected = bruteForceKeys(r.getFDS(), r.getAttributes());
+    AttrSet prime;
+    for(auto &key: expected) {
+      prime |= key;
+    }
+    vector<AttrSet> found = findAllKeys(r.getFDS(), r.getAttributes());
+    expect(set<AttrSet>(found.begin(), found.end()) == expected && found.size() == expected.size(), "random relation: candidate keys");
+    expect(getPrimeAttributes(r.getFDS(), r.getAttributes()) == prime, "random relation: prime attributes");
+    expect(expected.count(r.getKey()) == 1, "random relation: the key is a candidate key");
+  }
+}
+
+static void checkDiscoveredBCNF(const string &table, const string &what) {
+  RelationInput input;
+  discoverRelationText(table, 1, input);
+  Relation r(input);
+  for(int polynomial = 0; polynomial<2; polynomial++) {
+    string name = what + (polynomial ? " (polynomial)" : " (projection)");
+    set<AttrSet> fragments = polynomial ? decomposeBCNFPolynomial(r) : decomposeBCNF(r);
+    AttrSet covered;
+    for(auto &fragment: fragments) {
+      covered |= fragment;
+    }
+    expect(covered == r.getAttributes(), name + ": fragments cover the relation");
+    expect(inBCNF(fragments, r.getFDS(), r.getAttributes()), name + ": fragments are in BCNF");
+    vector<pair<AttrSet,AttrSet>> joins;
+    expect(testJoinBySplits(fragments, r.getAttributes(), r.getFDS(), joins) != JOIN_LOSSY, name + ": decomposition is lossless");
+  }
+}
+
+//A table of the given rows with columns named a, b, ...
+static string tableText(const vector<vector<int>> &rows, int width) {
+  string table;
+  for(int c = 0; c<width; c++) {
+    table += string(c ? "," : "") + (char)('a' + c);
+  }
+  table += "\n";
+  for(auto &row: rows) {
+    for(int c = 0; c<width; c++) {
+      table += string(c ? "," : "") + to_string(row[c]);
+    }
+    table += "\n";
+  }
+  return table;
+}
+
+//Compares the FDs discovered in a table (rows of values, columns named a,
+//b, ...) against every minimal FD X -> A found by brute force: X -> A
+//holds when any two rows agreeing on X agree on A, and is minimal when it
+//holds for no X minus one attribute
+static void checkDiscoveredFDs(const vector<vector<int>> &rows, int width, int threads, const string &what) {
+  RelationInput input;
+  discoverRelationText(tableText(rows, width), threads, input);
+
+  set<pair<unsigned,int>> discovered;
+  for(auto &dep: input.fds) {
+    unsigned mask = 0;
+    for(int attr: dep.first) {
+      mask |= 1u << (input.dictionary.getName(attr)[0] - 'A');
+    }
+    for(int attr: dep.second) {
+      discovered.insert(make_pair(mask, input.dictionary.getName(attr)[0] - 'A'));
+    }
+  }
+
+  auto holds = [&](unsigned mask, int a) {
+    for(size_t r = 0; r<rows.size(); r++) {
+      for(size_t s = r + 1; s<rows.size(); s++) {
+        bool agree = true;
+        for(int c = 0; c<width; c++) {
+          if(mask >> c & 1 && rows[r][c] != rows[s][c]) agree = false;
+        }
+        if(agree && rows[r][a] != rows[s][a]) return false;
+      }
+    }
+    return true;
+  };
+  set<pair<unsigned,int>> minimal;
+  for(int a = 0; a<width; a++) {
+    for(unsigned mask = 0; mask < (1u << width); mask++) {
+      if(mask >> a & 1 || !holds(mask, a)) continue;
+      bool smaller = false;
+      for(int c = 0; c<width; c++) {
+        if(mask >> c & 1 && holds(mask & ~(1u << c), a)) smaller = true;
+      }
+      if(!smaller) minimal.insert(make_pair(mask, a));
+    }
+  }
+  expect(discovered == minimal, what + ": discovered FDs are the minimal FDs of the table");
+}
+
+static void checkDiscovery() {
+
+  //Constant columns give FDs with an empty LHS
+  checkDiscoveredBCNF("a,b,c\n1,x,k\n2,y,k\n3,y,k\n", "constant column");
+  checkDiscoveredBCNF("a,b,c\n1,2,3\n", "single row");
+  checkDiscoveredBCNF("a,b,c,d\n1,x,k,k\n2,y,k,k\n2,y,k,k\n", "two constant columns");
+
+  //Random tables with few distinct values, so with constant columns and
+  //duplicate rows
+  mt19937 rng(2);
+  for(int round = 0; round<500; round++) {
+    int width = 2 + rng() % 4;
+    int values = 1 + rng() % 3;
+    vector<vector<int>> rows;
+    for(int row = rng() % 8; row > 0; row--) {
+      rows.push_back(vector<int>());
+      for(int c = 0; c<width; c++) {
+        rows.back().push_back(rng() % values);
+      }
+    }
+    for(int copies = rows.empty() ? 0 : rng() % 3; copies > 0; copies--) {
+      rows.push_back(rows[rng() % rows.size()]);
+    }
+    checkDiscoveredBCNF(tableText(rows, width), "random table");
+    checkDiscoveredFDs(rows, width, 1, "random table");
+  }
+
+  //Wider tables, with the lattice levels computed on several threads
+  for(int round = 0; round<300; round++) {
+    int width = 3 + rng() % 4;
+    int values = 1 + rng() % 4;
+    vector<vector<int>> rows;
+    for(int row = rng() % 16; row > 0; row--) {
+      rows.push_back(vector<int>());
+      for(int c = 0; c<width; c++) {
+        rows.back().push_back(rng() % values);
+      }
+    }
+    for(int copies = rows.empty() ? 0 : rng() % 4; copies > 0; copies--) {
+      rows.push_back(rows[rng() % rows.size()]);
+    }
+    checkDiscoveredFDs(rows, width, 1 + round % 4, "wide random table");
+  }
+}
+
+int main() {
+  checkClosure();
+  checkAttrSet();
+  checkTestcases();
+  checkMinimize();
+  checkKeys();
+  checkChase();
+  checkSplits();
+  checkBatch();
+  checkStream();
+  checkParser();
+  checkProjection();
+  checkBCNF();
+  checkBCNFTree();
+  checkSynthesis();
+  checkClosureCache();
+  checkKernels();
+  checkBench();
+  checkStats();
+  checkReports();
+  checkArena();
+  checkSemiNaiveChase();
+  checkServer();
+  checkDiskCache();
+  checkRemoveFD();
+  checkDiscovery();
+  if(failures == 0) cout<<"All checks passed"<<endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+/*
+	Per-thread LRU cache of attribute closures. Every ClosureEngine on a
+  thread looks its closures up here, keyed by a fingerprint of the FDs it
+  currently has enabled and the set whose closure is asked for, so
+  minimize, findKey and the synthesis algorithms reuse each other's work
+  whenever they run over the same FDs.
+*/
+
+#include <list>
+#include <atomic>
+#include <unordered_map>
+#include "relational.h"
+
+using namespace std;
+
+//At most this many subsets X - a are probed for a cached closure on a miss
+static const int MAX_SUBSET_PROBES = 4;
+
+static atomic<size_t> defaultCapacity(4096);
+static atomic<long> totalHits(0);
+static atomic<long> totalSubsetHits(0);
+static atomic<long> totalMisses(0);
+
+ClosureCache::ClosureCache(size_t capacity) {
+  this->capacity = capacity;
+}
+
+//The cache of the calling thread, resized to the current default capacity
+ClosureCache &ClosureCache::local() {
+  static thread_local ClosureCache cache(defaultCapacity);
+  size_t capacity = defaultCapacity.load(memory_order_relaxed);
+  if(cache.capacity != capacity) cache.setCapacity(capacity);
+  return cache;
+}
+
+void ClosureCache::setCapacity(size_t capacity) {
+  this->capacity = capacity;
+  while(entries.size() > capacity) {
+    lookup.erase(entries.back().first);
+    entries.pop_back();
+  }
+}
+
+const AttrSet *ClosureCache::find(uint64_t version, const AttrSet &X) {
+  auto itr = lookup.find(make_pair(version, X));
+  if(itr == lookup.end()) return NULL;
+  entries.splice(entries.begin(), entries, itr->second);
+  return &itr->second->second;
+}
+
+void ClosureCache::insert(uint64_t version, const AttrSet &X, const AttrSet &closure) {
+  if(capacity == 0) return;
+  Key key = make_pair(version, X);
+  auto itr = lookup.find(key);
+  if(itr != lookup.end()) {
+    entries.splice(entries.begin(), entries, itr->second);
+    return;
+  }
+  if(entries.size() >= capacity) {
+    lookup.erase(entries.back().first);
+    entries.pop_back();
+  }
+  entries.push_front(make_pair(key, closure));
+  lookup[key] = entries.begin();
+}
+
+//Looks up the closure of X under the FDs with fingerprint version. On a
+//miss, the cached closure of a subset Z = X - a is returned in seed when
+//there is one: X+ contains Z+, and equals it when X lies inside Z+.
+//Returns true if closure holds the answer.
+bool ClosureCache::lookupClosure(uint64_t version, const AttrSet &X, AttrSet &closure, AttrSet &seed) {
+  if(capacity == 0) return false;
+
+  if(const AttrSet *hit = find(version, X)) {
+    closure = *hit;
+    totalHits.fetch_add(1, memory_order_relaxed);
+    return true;
+  }
+
+  seed = X;
+  int probes = 0;
+  for(int attr: X) {
+    if(probes++ == MAX_SUBSET_PROBES) break;
+    AttrSet Z = X;
+    Z.erase(attr);
+    const AttrSet *partial = find(version, Z);
+    if(partial == NULL) continue;
+    if(X.isSubsetOf(*partial)) {
+      closure = *partial;
+      insert(version, X, closure);
+      totalSubsetHits.fetch_add(1, memory_order_relaxed);
+      return true;
+    }
+    seed |= *partial;
+  }
+
+  totalMisses.fetch_add(1, memory_order_relaxed);
+  return false;
+}
+
+size_t ClosureCache::KeyHash::operator()(const Key &key) const {
+  return key.second.hash() ^ (key.first * 0x9e3779b97f4a7c15ULL);
+}
+
+//Capacity, in entries, of every thread's cache; 0 disables caching
+void setClosureCacheCapacity(size_t entries) {
+  defaultCapacity = entries;
+}
+
+ClosureCacheStats getClosureCacheStats() {
+  ClosureCacheStats stats;
+  stats.hits = totalHits;
+  stats.subsetHits = totalSubsetHits;
+  stats.misses = totalMisses;
+  return stats;
+}
@@ -0,0 +1,180 @@
+/*
+	Bitset closure kernel. The FDs are stored column-wise (see FDColumns)
+  and every pass tests a whole block of FDs against the current closure
+  at once: an FD fires when its LHS has no attribute outside the closure
+  and its RHS has one. Passes repeat until nothing fires. Blocks are 8 FDs
+  wide with AVX-512, 4 with AVX2 and 1 otherwise; the widest kernel the
+  CPU supports is picked at startup.
+*/
+
+#include <string>
+#include <vector>
+#include "relational.h"
+#include "stats.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+using namespace std;
+
+typedef bool (*ClosureKernel)(const FDColumns &fds, uint64_t *closure, int skip);
+
+//Fires the FD in lane j of a block if it is not skipped
+static inline bool fireFD(const FDColumns &fds, uint64_t *closure, int j, int skip) {
+  if(j == skip) return false;
+  for(int w = 0; w<fds.words; w++) {
+    closure[w] |= fds.rhs[w * fds.stride + j];
+  }
+  return true;
+}
+
+//Each kernel runs one pass over the FDs and returns true if any fired
+static bool passScalar(const FDColumns &fds, uint64_t *closure, int skip) {
+  bool changed = false;
+  for(int i = 0; i<fds.stride; i++) {
+    uint64_t missing = 0, adds = 0;
+    for(int w = 0; w<fds.words; w++) {
+      missing |= fds.lhs[w * fds.stride + i] & ~closure[w];
+      adds |= fds.rhs[w * fds.stride + i] & ~closure[w];
+    }
+    if(missing == 0 && adds != 0 && fireFD(fds, closure, i, skip)) changed = true;
+  }
+  return changed;
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("avx2")))
+static bool passAVX2(const FDColumns &fds, uint64_t *closure, int skip) {
+  bool changed = false;
+  const __m256i zero = _mm256_setzero_si256();
+  for(int i = 0; i<fds.stride; i += 4) {
+    __m256i missing = zero, adds = zero;
+    for(int w = 0; w<fds.words; w++) {
+      __m256i c = _mm256_set1_epi64x(closure[w]);
+      const uint64_t *l = &fds.lhs[w * fds.stride + i];
+      const uint64_t *r = &fds.rhs[w * fds.stride + i];
+      missing = _mm256_or_si256(missing, _mm256_andnot_si256(c, _mm256_loadu_si256((const __m256i *)l)));
+      adds = _mm256_or_si256(adds, _mm256_andnot_si256(c, _mm256_loadu_si256((const __m256i *)r)));
+    }
+    int ready = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(missing, zero)));
+    int idle = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(adds, zero)));
+    int fire = ready & ~idle;
+    while(fire != 0) {
+      int lane = __builtin_ctz(fire);
+      fire &= fire - 1;
+      if(fireFD(fds, closure, i + lane, skip)) changed = true;
+    }
+  }
+  return changed;
+}
+
+__attribute__((target("avx512f")))
+static bool passAVX512(const FDColumns &fds, uint64_t *closure, int skip) {
+  bool changed = false;
+  for(int i = 0; i<fds.stride; i += 8) {
+    __m512i missing = _mm512_setzero_si512(), adds = _mm512_setzero_si512();
+    for(int w = 0; w<fds.words; w++) {
+      __m512i outside = _mm512_set1_epi64(~closure[w]);
+      missing = _mm512_or_si512(missing, _mm512_and_si512(outside, _mm512_loadu_si512(&fds.lhs[w * fds.stride + i])));
+      adds = _mm512_or_si512(adds, _mm512_and_si512(outside, _mm512_loadu_si512(&fds.rhs[w * fds.stride + i])));
+    }
+    unsigned fire = _mm512_testn_epi64_mask(missing, missing) & _mm512_test_epi64_mask(adds, adds);
+    while(fire != 0) {
+      int lane = __builtin_ctz(fire);
+      fire &= fire - 1;
+      if(fireFD(fds, closure, i + lane, skip)) changed = true;
+    }
+  }
+  return changed;
+}
+#endif
+
+static ClosureKernel selectedKernel = passScalar;
+static const char *selectedName = "scalar";
+
+//Picks the widest kernel the CPU supports before main runs
+static bool detectKernel() {
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f")) {
+    selectedKernel = passAVX512;
+    selectedName = "avx512";
+  } else if(__builtin_cpu_supports("avx2")) {
+    selectedKernel = passAVX2;
+    selectedName = "avx2";
+  }
+#endif
+  return true;
+}
+
+static bool detected = detectKernel();
+
+//Forces a kernel ("scalar", "avx2" or "avx512"); returns false if the CPU
+//does not support it
+bool selectClosureKernel(const string &name) {
+  if(name == "scalar") {
+    selectedKernel = passScalar;
+    selectedName = "scalar";
+    return true;
+  }
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if(name == "avx2" && __builtin_cpu_supports("avx2")) {
+    selectedKernel = passAVX2;
+    selectedName = "avx2";
+    return true;
+  }
+  if(name == "avx512" && __builtin_cpu_supports("avx512f")) {
+    selectedKernel = passAVX512;
+    selectedName = "avx512";
+    return true;
+  }
+#endif
+  return false;
+}
+
+const char *closureKernelName() {
+  return selectedName;
+}
+
+//Extends closure (fds.words words) to its closure under the FDs, ignoring
+//the FD at position skip. Returns the number of passes it took.
+int closeOverColumns(const FDColumns &fds, uint64_t *closure, int skip) {
+  (void)detected;
+  int passes = 1;
+  while(selectedKernel(fds, closure, skip)) {
+    passes++;
+  }
+  STAT_ADD(STAT_FD_SCANS, (long)passes * fds.count);
+  return passes;
+}
+
+FDColumns::FDColumns() : lhs(RelationArena::current()), rhs(RelationArena::current()) {
+  words = 0;
+  count = 0;
+  stride = 0;
+}
+
+//Lays out n FDs over the given number of words. The stride is a multiple
+//of the widest block, and the padding lanes never fire.
+void FDColumns::reset(int n, int words) {
+  this->words = words;
+  count = n;
+  stride = (n + FD_BLOCK - 1) / FD_BLOCK * FD_BLOCK;
+  lhs.assign((size_t)words * stride, 0);
+  rhs.assign((size_t)words * stride, 0);
+}
+
+void FDColumns::setLHS(int i, const AttrSet &X) {
+  for(int w = 0; w<words; w++) {
+    lhs[w * stride + i] = X.word(w);
+  }
+}
+
+void FDColumns::setRHS(int i, const AttrSet &Y) {
+  for(int w = 0; w<words; w++) {
+    rhs[w * stride + i] = Y.word(w);
+  }
+}
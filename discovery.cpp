@@ -0,0 +1,503 @@
+/*
+	FD discovery from table contents (TANE). The table is read into
+  dictionary encoded columns, one integer code per distinct value. Every
+  attribute set X is represented by its stripped partition: the classes of
+  rows that agree on X, singletons left out. X -> A holds exactly when X
+  and X + A have the same error (rows in the partition minus classes).
+  The lattice of attribute sets is walked level by level; the sets of the
+  next level are products of two sets of this one sharing all but their
+  last attribute, and the candidate sets C+(X) drop every set that can no
+  longer give a minimal FD. The products of a level are computed in
+  parallel.
+*/
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include "relational.h"
+#include "threadpool.h"
+#include "stats.h"
+
+using namespace std;
+
+//Sets of the next level are computed in blocks of this many per task
+static const int PRODUCT_BLOCK = 32;
+
+//A table as dictionary encoded columns: columns[c][row] is the code of the
+//value in that row, codes of column c run from 0 to distinct[c] - 1
+struct Table {
+  vector<string> names;
+  vector<vector<int>> columns;
+  vector<int> distinct;
+  int rows;
+};
+
+//The rows of class i are rows[starts[i]] .. rows[starts[i + 1] - 1]
+struct Partition {
+  vector<int> rows;
+  vector<int> starts;
+  long error() const { return (long)rows.size() - ((long)starts.size() - 1); }
+};
+
+//A set of the current level. left and right are the sets of the previous
+//level it is the product of.
+struct Candidate {
+  AttrSet attrs;
+  int last;
+  AttrSet cplus;
+  long error;
+  Partition partition;
+  int left;
+  int right;
+};
+
+struct Level {
+  vector<Candidate> sets;
+  unordered_map<AttrSet, int, AttrSetHash> index;
+};
+
+//Reads the field starting at pos and moves pos past its separator or line
+//end. Returns false when the field ends the record. Quoted fields (CSV
+//only) may hold separators, newlines and doubled quotes; the latter are
+//unescaped into storage, which keeps field valid.
+static bool nextField(string_view text, size_t &pos, char separator, deque<string> &storage, string_view &field) {
+
+  if(separator == ',' && pos < text.size() && text[pos] == '"') {
+    size_t start = pos + 1;
+    size_t end = start;
+    bool escaped = false;
+    while(true) {
+      end = text.find('"', end);
+      if(end == string_view::npos) throw RelationError("ERROR: Unterminated quoted field in table");
+      if(end + 1 < text.size() && text[end + 1] == '"') {
+        escaped = true;
+        end += 2;
+        continue;
+      }
+      break;
+    }
+    field = text.substr(start, end - start);
+    if(escaped) {
+      string unescaped;
+      for(size_t i = 0; i<field.size(); i++) {
+        unescaped.push_back(field[i]);
+        if(field[i] == '"') i++;
+      }
+      storage.push_back(unescaped);
+      field = storage.back();
+    }
+    pos = end + 1;
+    if(pos < text.size() && text[pos] == '\r') pos++;
+    if(pos < text.size() && text[pos] == separator) {
+      pos++;
+      return true;
+    }
+    if(pos < text.size() && text[pos] != '\n') throw RelationError("ERROR: Unexpected text after a quoted field in table");
+    pos++;
+    return false;
+  }
+
+  size_t end = pos;
+  while(end < text.size() && text[end] != separator && text[end] != '\n') end++;
+  field = text.substr(pos, end - pos);
+  if(!field.empty() && field.back() == '\r') field.remove_suffix(1);
+  bool more = end < text.size() && text[end] == separator;
+  pos = end + 1;
+  return more;
+}
+
+//Splits text into the header names and the encoded columns. Blank lines
+//are skipped.
+static void readTable(string_view text, Table &table) {
+  STAT_PHASE(PHASE_PARSE);
+
+  size_t lineEnd = text.find('\n');
+  string_view header = text.substr(0, lineEnd == string_view::npos ? text.size() : lineEnd);
+  char separator = header.find('\t') != string_view::npos ? '\t' : ',';
+
+  deque<string> storage;
+  string_view field;
+  size_t pos = 0;
+  bool more = true;
+  while(more) {
+    more = nextField(text, pos, separator, storage, field);
+    table.names.push_back(string(field));
+  }
+
+  int width = table.names.size();
+  vector<unordered_map<string_view, int>> codes(width);
+  table.columns.assign(width, vector<int>());
+  table.rows = 0;
+  while(pos < text.size()) {
+    if(text[pos] == '\n' || (text[pos] == '\r' && pos + 1 < text.size() && text[pos + 1] == '\n')) {
+      pos = text.find('\n', pos) + 1;
+      continue;
+    }
+    int column = 0;
+    more = true;
+    while(more) {
+      more = nextField(text, pos, separator, storage, field);
+      if(column == width) {
+        throw RelationError("ERROR: Row " + to_string(table.rows + 1) + " of the table has more fields than the header");
+      }
+      auto inserted = codes[column].emplace(field, codes[column].size());
+      table.columns[column].push_back(inserted.first->second);
+      column++;
+    }
+    if(column != width) {
+      throw RelationError("ERROR: Row " + to_string(table.rows + 1) + " of the table has fewer fields than the header");
+    }
+    table.rows++;
+  }
+
+  for(auto &column: codes) {
+    table.distinct.push_back(column.size());
+  }
+}
+
+//The partition of a single column, by counting sort on its codes. Values
+//seen once get an empty range, so their rows are left out.
+static void columnPartition(const vector<int> &codes, int distinct, Partition &partition) {
+  vector<int> offset(distinct + 1, 0);
+  for(int code: codes) {
+    offset[code + 1]++;
+  }
+  partition.starts.assign(1, 0);
+  for(int code = 0; code<distinct; code++) {
+    int size = offset[code + 1];
+    offset[code + 1] = offset[code] + (size >= 2 ? size : 0);
+    if(size >= 2) partition.starts.push_back(offset[code + 1]);
+  }
+
+  partition.rows.resize(partition.starts.back());
+  vector<int> next(offset.begin(), offset.end() - 1);
+  for(int row = 0; row<(int)codes.size(); row++) {
+    int code = codes[row];
+    if(next[code] < offset[code + 1]) partition.rows[next[code]++] = row;
+  }
+}
+
+//Scratch space for products, one per thread. owner[row] is the class of
+//row in the left partition, or -1; it is all -1 between products, as
+//count is all 0.
+struct ProductScratch {
+  vector<int> owner;
+  vector<int> count;
+  vector<int> position;
+  vector<int> touched;
+};
+
+//The partition of the union of the sets of a and b. Each class of b is
+//split by the classes of a its rows belong to: the rows are counted per
+//class of a, then written straight into their place in product.
+static void multiply(const Partition &a, const Partition &b, int rows, Partition &product) {
+  static thread_local ProductScratch scratch;
+  if((int)scratch.owner.size() < rows) scratch.owner.resize(rows, -1);
+  int classes = a.starts.size() - 1;
+  if((int)scratch.count.size() < classes) {
+    scratch.count.resize(classes, 0);
+    scratch.position.resize(classes);
+  }
+  vector<int> &owner = scratch.owner;
+  vector<int> &count = scratch.count;
+  vector<int> &position = scratch.position;
+  vector<int> &touched = scratch.touched;
+
+  for(int i = 0; i<classes; i++) {
+    for(int k = a.starts[i]; k<a.starts[i + 1]; k++) {
+      owner[a.rows[k]] = i;
+    }
+  }
+
+  product.rows.clear();
+  product.starts.assign(1, 0);
+  for(int j = 0; j + 1<(int)b.starts.size(); j++) {
+    for(int k = b.starts[j]; k<b.starts[j + 1]; k++) {
+      int i = owner[b.rows[k]];
+      if(i >= 0 && count[i]++ == 0) touched.push_back(i);
+    }
+
+    int end = product.rows.size();
+    for(int i: touched) {
+      if(count[i] < 2) continue;
+      position[i] = end;
+      end += count[i];
+      product.starts.push_back(end);
+    }
+    product.rows.resize(end);
+    for(int k = b.starts[j]; k<b.starts[j + 1]; k++) {
+      int i = owner[b.rows[k]];
+      if(i >= 0 && count[i] >= 2) product.rows[position[i]++] = b.rows[k];
+    }
+
+    for(int i: touched) {
+      count[i] = 0;
+    }
+    touched.clear();
+  }
+
+  for(int k = 0; k<(int)a.rows.size(); k++) {
+    owner[a.rows[k]] = -1;
+  }
+  STAT_ADD(STAT_PARTITION_PRODUCTS, 1);
+}
+
+//Whether every class of partition agrees on column
+static bool determines(const Partition &partition, const vector<int> &column) {
+  for(int i = 0; i + 1<(int)partition.starts.size(); i++) {
+    int code = column[partition.rows[partition.starts[i]]];
+    for(int k = partition.starts[i] + 1; k<partition.starts[i + 1]; k++) {
+      if(column[partition.rows[k]] != code) return false;
+    }
+  }
+  return true;
+}
+
+//Runs task(i) for i in [0, count), in blocks on pool when there is one
+static void forEachBlock(WorkStealingPool *pool, int count, const function<void(int)> &task) {
+  if(pool == NULL) {
+    for(int i = 0; i<count; i++) task(i);
+    return;
+  }
+  for(int start = 0; start<count; start += PRODUCT_BLOCK) {
+    int end = min(count, start + PRODUCT_BLOCK);
+    pool->submit([&task, start, end] {
+      for(int i = start; i<end; i++) task(i);
+    });
+  }
+  pool->wait();
+}
+
+//Finds the FDs X - A -> A with A in X and C+(X), and narrows C+(X)
+static void computeDependencies(Level &level, const Level &previous, const AttrSet &all, vector<FD> &fds) {
+  for(auto &candidate: level.sets) {
+    candidate.cplus = all;
+    for(int attr: candidate.attrs) {
+      AttrSet rest = candidate.attrs;
+      rest.erase(attr);
+      candidate.cplus &= previous.sets[previous.index.at(rest)].cplus;
+    }
+
+    for(int attr: candidate.attrs & candidate.cplus) {
+      AttrSet rest = candidate.attrs;
+      rest.erase(attr);
+      if(previous.sets[previous.index.at(rest)].error != candidate.error) continue;
+      AttrSet rhs;
+      rhs.insert(attr);
+      fds.push_back(make_pair(rest, rhs));
+      candidate.cplus.erase(attr);
+      candidate.cplus &= candidate.attrs;
+    }
+  }
+}
+
+//Drops the sets with an empty C+, and the keys after reporting their
+//minimal FDs: X -> A is minimal if no X - B determines A. The previous
+//level still has its partitions, which settle that directly.
+static void prune(Level &level, const Level &previous, const Table &table, vector<FD> &fds) {
+  vector<Candidate> kept;
+  for(auto &candidate: level.sets) {
+    if(candidate.cplus.empty()) continue;
+    if(candidate.error != 0) {
+      kept.push_back(move(candidate));
+      continue;
+    }
+
+    for(int attr: candidate.cplus - candidate.attrs) {
+      bool minimal = true;
+      for(int other: candidate.attrs) {
+        AttrSet rest = candidate.attrs;
+        rest.erase(other);
+        if(determines(previous.sets[previous.index.at(rest)].partition, table.columns[attr])) {
+          minimal = false;
+          break;
+        }
+      }
+      if(!minimal) continue;
+      AttrSet rhs;
+      rhs.insert(attr);
+      fds.push_back(make_pair(candidate.attrs, rhs));
+    }
+  }
+
+  level.sets = move(kept);
+  level.index.clear();
+  for(int i = 0; i<(int)level.sets.size(); i++) {
+    level.index[level.sets[i].attrs] = i;
+  }
+}
+
+//Joins the sets of level that differ only in their last attribute into
+//the sets of the next level whose subsets all survived, then computes
+//their partitions
+static void generateNextLevel(const Level &level, const Table &table, WorkStealingPool *pool, Level &next) {
+
+  map<AttrSet, vector<int>> blocks;
+  for(int i = 0; i<(int)level.sets.size(); i++) {
+    AttrSet prefix = level.sets[i].attrs;
+    prefix.erase(level.sets[i].last);
+    blocks[prefix].push_back(i);
+  }
+
+  for(auto &block: blocks) {
+    vector<int> &members = block.second;
+    sort(members.begin(), members.end(), [&](int a, int b) { return level.sets[a].last < level.sets[b].last; });
+    for(int a = 0; a<(int)members.size(); a++) {
+      for(int b = a + 1; b<(int)members.size(); b++) {
+        const Candidate &left = level.sets[members[a]];
+        const Candidate &right = level.sets[members[b]];
+        AttrSet attrs = left.attrs;
+        attrs.insert(right.last);
+
+        bool closed = true;
+        for(int attr: block.first) {
+          AttrSet subset = attrs;
+          subset.erase(attr);
+          if(!level.index.count(subset)) {
+            closed = false;
+            break;
+          }
+        }
+        if(!closed) continue;
+
+        Candidate candidate;
+        candidate.attrs = attrs;
+        candidate.last = right.last;
+        candidate.left = members[a];
+        candidate.right = members[b];
+        next.index[attrs] = next.sets.size();
+        next.sets.push_back(move(candidate));
+      }
+    }
+  }
+
+  forEachBlock(pool, next.sets.size(), [&](int i) {
+    Candidate &candidate = next.sets[i];
+    multiply(level.sets[candidate.left].partition, level.sets[candidate.right].partition, table.rows, candidate.partition);
+    candidate.error = candidate.partition.error();
+  });
+}
+
+//Every minimal non-trivial FD X -> A of the table, over column numbers
+static vector<FD> discoverFDs(const Table &table, int threads) {
+  STAT_PHASE(PHASE_DISCOVER);
+
+  unique_ptr<WorkStealingPool> pool;
+  if(threads > 1) pool.reset(new WorkStealingPool(threads));
+
+  int width = table.names.size();
+  AttrSet all;
+  for(int column = 0; column<width; column++) {
+    all.insert(column);
+  }
+
+  //Level 0 is the empty set: every row in one class
+  Level previous;
+  Candidate empty;
+  empty.last = -1;
+  empty.left = -1;
+  empty.right = -1;
+  empty.cplus = all;
+  empty.partition.starts.assign(1, 0);
+  if(table.rows >= 2) {
+    for(int row = 0; row<table.rows; row++) {
+      empty.partition.rows.push_back(row);
+    }
+    empty.partition.starts.push_back(table.rows);
+  }
+  empty.error = empty.partition.error();
+  previous.index[empty.attrs] = 0;
+  previous.sets.push_back(move(empty));
+
+  Level level;
+  level.sets.resize(width);
+  for(int column = 0; column<width; column++) {
+    level.sets[column].attrs.insert(column);
+    level.sets[column].last = column;
+    level.sets[column].left = -1;
+    level.sets[column].right = -1;
+    level.index[level.sets[column].attrs] = column;
+  }
+  forEachBlock(pool.get(), width, [&](int column) {
+    Candidate &candidate = level.sets[column];
+    columnPartition(table.columns[column], table.distinct[column], candidate.partition);
+    candidate.error = candidate.partition.error();
+  });
+
+  vector<FD> fds;
+  while(!level.sets.empty()) {
+    computeDependencies(level, previous, all, fds);
+    prune(level, previous, table, fds);
+
+    //Only this level's partitions are needed from here on: the next one
+    //is built from them and prunes its keys against them
+    for(auto &candidate: previous.sets) {
+      candidate.partition = Partition();
+    }
+    Level next;
+    generateNextLevel(level, table, pool.get(), next);
+    previous = move(level);
+    level = move(next);
+  }
+
+  STAT_ADD(STAT_FDS_DISCOVERED, fds.size());
+  return fds;
+}
+
+//Reads a table and fills input with its columns as attributes and the
+//FDs that hold in it. Column names are upper-cased and stripped of spaces
+//like attribute names in relation files.
+void discoverRelationText(string_view text, int threads, RelationInput &input) {
+
+  Table table;
+  readTable(text, table);
+
+  AttributeDictionary &dictionary = input.dictionary;
+  vector<string> names;
+  for(auto &column: table.names) {
+    string name;
+    for(char c: column) {
+      if(c == ' ' || c == '\t' || c == '\r') continue;
+      name.push_back(toupper((unsigned char)c));
+    }
+    if(name.empty()) throw RelationError("ERROR: Every column of the table needs a name");
+    if(dictionary.find(name) >= 0) throw RelationError("ERROR: Column " + name + " appears twice in the table");
+    dictionary.intern(name);
+    names.push_back(name);
+  }
+
+  //Number the attributes in name order so that ids follow name order
+  dictionary.sortByName();
+  vector<int> ids;
+  for(auto &name: names) {
+    ids.push_back(dictionary.find(name));
+    input.attributes.insert(ids.back());
+  }
+
+  for(auto &dep: discoverFDs(table, threads)) {
+    AttrSet X, Y;
+    for(int column: dep.first) {
+      X.insert(ids[column]);
+    }
+    for(int column: dep.second) {
+      Y.insert(ids[column]);
+    }
+    input.fds.insert(make_pair(X, Y));
+  }
+}
+
+//Returns false if the file cannot be opened
+bool discoverRelationFile(const string &fileName, int threads, RelationInput &input) {
+
+  MappedFile file(fileName);
+  if(!file.isOpen()) {
+    return false;
+  }
+  discoverRelationText(file.getText(), threads, input);
+  return true;
+}
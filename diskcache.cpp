@@ -0,0 +1,371 @@
+/*
+	Persistent result cache. A result is stored in a file named after a
+  hash of its canonical key: the attribute names (ids follow name order),
+  the FDs merged by left hand side, the decompositions and the operation
+  with the options that change its result. Files hold the key and the result in a flat native-endian
+  binary layout read straight from a memory mapping:
+
+    "RELC", format version, key length, payload length (uint32 each),
+    checksum of key and payload (uint64), key, payload
+
+  Entries are written to a temporary file and renamed into place, so
+  processes sharing a directory only ever see complete entries. A file
+  that does not match its key, length or checksum is a miss.
+*/
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+static const char CACHE_MAGIC[4] = {'R', 'E', 'L', 'C'};
+static const uint32_t CACHE_VERSION = 2;
+static const size_t HEADER_BYTES = 4 + 4 + 4 + 4 + 8;
+
+static atomic<long> temporaryFiles(0);
+
+//Hashes 8 bytes at a time, so checking an entry costs little next to
+//reading it
+static uint64_t checksum(string_view data, uint64_t seed) {
+  uint64_t h = 14695981039346656037ULL ^ seed ^ data.size();
+  size_t i = 0;
+  for(; i + 8<=data.size(); i += 8) {
+    uint64_t word;
+    memcpy(&word, data.data() + i, 8);
+    h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 29;
+  }
+  for(; i<data.size(); i++) {
+    h = (h ^ (unsigned char)data[i]) * 1099511628211ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+//Appends values to an entry in the cache layout
+class EntryWriter {
+  private:
+  string &out;
+
+  public:
+  EntryWriter(string &out) : out(out) {}
+
+  void put32(uint32_t value) {
+    out.append((const char *)&value, sizeof(value));
+  }
+
+  void putSet(const AttrSet &s) {
+    put32(s.words());
+    out.append((const char *)s.data(), s.words() * sizeof(uint64_t));
+  }
+
+  void putString(const string &s) {
+    put32(s.size());
+    out.append(s);
+  }
+};
+
+//Reads values back; any read past the end makes the entry invalid
+class EntryReader {
+  private:
+  string_view in;
+  size_t offset;
+  bool valid;
+
+  bool take(void *value, size_t size) {
+    if(!valid || in.size() - offset < size) {
+      valid = false;
+      return false;
+    }
+    memcpy(value, in.data() + offset, size);
+    offset += size;
+    return true;
+  }
+
+  public:
+  EntryReader(string_view in) : in(in), offset(0), valid(true) {}
+  bool isValid() const { return valid && offset == in.size(); }
+
+  uint32_t get32() {
+    uint32_t value = 0;
+    take(&value, sizeof(value));
+    return value;
+  }
+
+  AttrSet getSet() {
+    AttrSet s;
+    uint32_t words = get32();
+    if(!valid || (in.size() - offset) / sizeof(uint64_t) < words) {
+      valid = false;
+      return s;
+    }
+    uint64_t bits[8];
+    for(uint32_t w = 0; w<words; w += 8) {
+      uint32_t n = min(words - w, (uint32_t)8);
+      memcpy(bits, in.data() + offset, n * sizeof(uint64_t));
+      offset += n * sizeof(uint64_t);
+      if(w == 0) {
+        s.insertWords(bits, n);
+      } else {
+        for(uint32_t i = 0; i<n; i++) {
+          for(uint64_t b = bits[i]; b != 0; b &= b - 1) s.insert((w + i) * 64 + __builtin_ctzll(b));
+        }
+      }
+    }
+    return s;
+  }
+
+  string getString() {
+    uint32_t length = get32();
+    if(!valid || in.size() - offset < length) {
+      valid = false;
+      return string();
+    }
+    string s(in.data() + offset, length);
+    offset += length;
+    return s;
+  }
+
+  //A count of items each at least minimum bytes long, checked against what
+  //is left so a damaged entry cannot ask for a huge allocation
+  uint32_t getCount(size_t minimum) {
+    uint32_t count = get32();
+    if(valid && (size_t)count > (in.size() - offset) / minimum) valid = false;
+    return valid ? count : 0;
+  }
+};
+
+//The canonical form of everything a result depends on, partly binary
+string resultCacheKey(const RelationInput &input, const ToolOptions &options) {
+
+  string key = options.op == OP_LJ ? "lj" : (options.op == OP_3NF ? "3nf" : "bcnf");
+  if(options.op == OP_LJ) {
+    key += options.forceTableau ? " tableau" : "";
+    key += options.quiet ? " quiet" : "";
+  }
+  if(options.op == OP_BCNF && options.strategy == BCNF_POLYNOMIAL) key += " polynomial";
+  key += '\n';
+
+  for(int id = 0; id<input.dictionary.size(); id++) {
+    key += input.dictionary.getName(id);
+    key += ',';
+  }
+  key += '\n';
+
+  EntryWriter out(key);
+  out.putSet(input.attributes);
+
+  //The FDs with the same LHS X as one FD X -> Y, Y holding every attribute
+  //they determine outside X. The set is ordered by LHS, so equal ones are
+  //adjacent.
+  string fds;
+  EntryWriter fdsOut(fds);
+  uint32_t merged = 0;
+  for(auto itr = input.fds.begin(); itr != input.fds.end();) {
+    const AttrSet &X = itr->first;
+    AttrSet Y;
+    for(; itr != input.fds.end() && itr->first == X; ++itr) {
+      Y |= itr->second;
+    }
+    Y -= X;
+    if(Y.empty()) continue;
+    fdsOut.putSet(X);
+    fdsOut.putSet(Y);
+    merged++;
+  }
+  out.put32(merged);
+  key += fds;
+
+  out.put32(input.decompositions.size());
+  for(auto &decomp: input.decompositions) {
+    out.putSet(decomp);
+  }
+  return key;
+}
+
+//The entry for key: directory/<2 hex digits>/<30 hex digits>
+static string entryPath(const string &directory, const string &key) {
+  static const char *hex = "0123456789abcdef";
+  string name;
+  for(uint64_t h: {checksum(key, 0), checksum(key, 0x9e3779b97f4a7c15ULL)}) {
+    for(int shift = 60; shift >= 0; shift -= 4) {
+      name += hex[(h >> shift) & 0xf];
+    }
+  }
+  return directory + "/" + name.substr(0, 2) + "/" + name.substr(2);
+}
+
+static void encodeResult(const AnalysisResult &result, EntryWriter &out) {
+
+  out.put32(result.verdict);
+  out.put32(result.chased);
+  out.putSet(result.key);
+
+  out.put32(result.cover.size());
+  for(auto &dep: result.cover) {
+    out.putSet(dep.first);
+    out.putSet(dep.second);
+  }
+
+  out.put32(result.keys.size());
+  for(auto &key: result.keys) {
+    out.putSet(key);
+  }
+  out.putSet(result.prime);
+
+  out.put32(result.decompositions.size());
+  for(auto &decomp: result.decompositions) {
+    out.putSet(decomp);
+  }
+
+  out.put32(result.joins.size());
+  for(auto &join: result.joins) {
+    out.putSet(join.first);
+    out.putSet(join.second);
+  }
+
+  out.put32(result.tableau.size());
+  for(auto &row: result.tableau) {
+    out.put32(row.size());
+    for(auto &cell: row) {
+      out.putString(cell);
+    }
+  }
+
+  out.put32(result.tree.size());
+  for(auto &node: result.tree) {
+    out.putSet(node.fragment);
+    out.putSet(node.split.first);
+    out.putSet(node.split.second);
+    out.put32(node.left);
+    out.put32(node.right);
+  }
+}
+
+static bool decodeResult(string_view payload, AnalysisResult &result) {
+
+  EntryReader in(payload);
+  uint32_t verdict = in.get32();
+  if(verdict > JOIN_UNDECIDED) return false;
+  result.verdict = (JoinTest)verdict;
+  result.chased = in.get32() != 0;
+  result.key = in.getSet();
+
+  //Sets were written in order, so every insertion goes at the end
+  for(uint32_t n = in.getCount(8); n > 0; n--) {
+    AttrSet X = in.getSet();
+    result.cover.insert(result.cover.end(), make_pair(X, in.getSet()));
+  }
+
+  result.keys.resize(in.getCount(4));
+  for(auto &key: result.keys) {
+    key = in.getSet();
+  }
+  result.prime = in.getSet();
+
+  for(uint32_t n = in.getCount(4); n > 0; n--) {
+    result.decompositions.insert(result.decompositions.end(), in.getSet());
+  }
+
+  for(uint32_t n = in.getCount(8); n > 0; n--) {
+    AttrSet left = in.getSet();
+    result.joins.push_back(make_pair(left, in.getSet()));
+  }
+
+  result.tableau.resize(in.getCount(4));
+  for(auto &row: result.tableau) {
+    row.resize(in.getCount(4));
+    for(auto &cell: row) {
+      cell = in.getString();
+    }
+  }
+
+  result.tree.resize(in.getCount(20));
+  for(auto &node: result.tree) {
+    node.fragment = in.getSet();
+    node.split.first = in.getSet();
+    node.split.second = in.getSet();
+    node.left = (int32_t)in.get32();
+    node.right = (int32_t)in.get32();
+    if(node.left < -1 || node.right < -1) return false;
+    if(node.left >= (int)result.tree.size() || node.right >= (int)result.tree.size()) return false;
+  }
+
+  return in.isValid();
+}
+
+//Fills in result from the entry for key; returns false on a miss. The
+//name, dictionary and attributes come from the request, not the entry.
+bool loadCachedResult(const string &directory, const string &key, AnalysisResult &result) {
+
+  MappedFile file(entryPath(directory, key));
+  string_view text = file.isOpen() ? file.getText() : string_view();
+  bool hit = false;
+  if(text.size() >= HEADER_BYTES && memcmp(text.data(), CACHE_MAGIC, 4) == 0) {
+    uint32_t version, keyLength, payloadLength;
+    uint64_t sum;
+    memcpy(&version, text.data() + 4, 4);
+    memcpy(&keyLength, text.data() + 8, 4);
+    memcpy(&payloadLength, text.data() + 12, 4);
+    memcpy(&sum, text.data() + 16, 8);
+    string_view body = text.substr(HEADER_BYTES);
+    hit = version == CACHE_VERSION && keyLength == key.size() && body.size() == (size_t)keyLength + payloadLength &&
+          body.substr(0, keyLength) == key && checksum(body, 0) == sum &&
+          decodeResult(body.substr(keyLength), result);
+  }
+
+  if(hit) {
+    STAT_ADD(STAT_DISK_HITS, 1);
+  } else {
+    STAT_ADD(STAT_DISK_MISSES, 1);
+  }
+  return hit;
+}
+
+//Stores result under key. Failures (a read-only or full disk) only mean
+//the result is not cached.
+void storeCachedResult(const string &directory, const string &key, const AnalysisResult &result) {
+
+  string payload;
+  EntryWriter out(payload);
+  encodeResult(result, out);
+
+  string entry(CACHE_MAGIC, 4);
+  EntryWriter header(entry);
+  header.put32(CACHE_VERSION);
+  header.put32(key.size());
+  header.put32(payload.size());
+  string body = key + payload;
+  uint64_t sum = checksum(body, 0);
+  entry.append((const char *)&sum, sizeof(sum));
+  entry += body;
+
+  string path = entryPath(directory, key);
+  string bucket = path.substr(0, path.rfind('/'));
+  mkdir(directory.c_str(), 0777);
+  if(mkdir(bucket.c_str(), 0777) != 0 && errno != EEXIST) return;
+
+  string temporary = bucket + "/.tmp." + to_string(getpid()) + "." + to_string(temporaryFiles++);
+  {
+    ofstream file(temporary, ios::binary);
+    file.write(entry.data(), entry.size());
+    if(!file.good()) {
+      file.close();
+      unlink(temporary.c_str());
+      return;
+    }
+  }
+  if(rename(temporary.c_str(), path.c_str()) != 0) unlink(temporary.c_str());
+}
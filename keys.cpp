@@ -0,0 +1,99 @@
+/*
+	Candidate key enumeration. Attributes are first classified by where
+  they occur in the FDs: those that never appear on a RHS belong to every
+  key, those that appear only on a RHS belong to none. The remaining keys
+  are found with the Lucchesi-Osborn algorithm.
+*/
+
+#include <vector>
+#include <functional>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+//Removes attributes of candidates from superkey, in ascending order, for
+//as long as the result stays a superkey
+AttrSet reduceToKey(ClosureEngine &engine, const AttrSet &superkey, const AttrSet &attributes, const AttrSet &candidates) {
+  AttrSet key = superkey;
+  AttrSet removable = superkey & candidates;
+  for(int attr: removable) {
+    key.erase(attr);
+    if(!attributes.isSubsetOf(engine.getClosure(key))) {
+      key.insert(attr);
+    }
+  }
+  return key;
+}
+
+void enumerateKeys(const FDSet &fdset, const AttrSet &attributes, const function<bool(const AttrSet &)> &onKey) {
+
+  AttrSet lhsAttrs, rhsAttrs;
+  for(auto &dep: fdset) {
+    lhsAttrs |= dep.first;
+    rhsAttrs |= dep.second;
+  }
+
+  //Attributes never derived are in every key, attributes that are only
+  //derived are in none; only the ones on both sides need searching
+  AttrSet core = attributes - rhsAttrs;
+  AttrSet both = (lhsAttrs & rhsAttrs) & attributes;
+
+  ClosureEngine engine(fdset);
+  if(attributes.isSubsetOf(engine.getClosure(core))) {
+    STAT_ADD(STAT_KEYS, 1);
+    onKey(core);
+    return;
+  }
+
+  vector<AttrSet> keys;
+  keys.push_back(reduceToKey(engine, core | both, attributes, both));
+  STAT_ADD(STAT_KEYS, 1);
+  if(!onKey(keys[0])) return;
+
+  //Lucchesi-Osborn: every key other than the known ones is contained in
+  //X + (K - Y) for some known key K and some FD X -> Y
+  for(int k = 0; k<(int)keys.size(); k++) {
+    for(auto &dep: fdset) {
+      AttrSet S = dep.first | (keys[k] - dep.second);
+      bool covered = false;
+      for(auto &known: keys) {
+        if(known.isSubsetOf(S)) {
+          covered = true;
+          break;
+        }
+      }
+      if(covered) continue;
+
+      keys.push_back(reduceToKey(engine, S, attributes, both));
+      STAT_ADD(STAT_KEYS, 1);
+      if(!onKey(keys.back())) return;
+    }
+  }
+}
+
+vector<AttrSet> findAllKeys(const FDSet &fdset, const AttrSet &attributes, size_t limit) {
+  vector<AttrSet> keys;
+  if(limit == 0) return keys;
+  enumerateKeys(fdset, attributes, [&](const AttrSet &key) {
+    keys.push_back(key);
+    return keys.size() < limit;
+  });
+  return keys;
+}
+
+AttrSet getPrimeAttributes(const FDSet &fdset, const AttrSet &attributes) {
+  AttrSet lhsAttrs, rhsAttrs;
+  for(auto &dep: fdset) {
+    lhsAttrs |= dep.first;
+    rhsAttrs |= dep.second;
+  }
+  AttrSet possible = attributes - (rhsAttrs - lhsAttrs);
+
+  AttrSet prime;
+  enumerateKeys(fdset, attributes, [&](const AttrSet &key) {
+    prime |= key;
+    return prime != possible;
+  });
+  return prime;
+}
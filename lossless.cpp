@@ -0,0 +1,339 @@
+/*
+	The S matrix (tableau) used to check if a decomposition follows the
+  lossless join property. Cells hold integer symbols: 0 is the
+  distinguished symbol of its column and r + 1 the non-distinguished
+  symbol that row r starts with. Equated symbols are merged with a
+  union-find per column, so one merge renames the symbol everywhere.
+  Before building the matrix, testJoinBySplits tries to decide the
+  question with a few closures by joining fragments two at a time.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <utility>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+//Above this many fragments the pairwise search costs more than the chase
+const int MAX_SPLIT_FRAGMENTS = 64;
+
+//Joining R1 and R2 is lossless iff (R1 ^ R2)+ contains R1 or R2. Repeatedly
+//joining such pairs decides binary decompositions exactly, and shows a
+//decomposition lossless whenever it is a tree of binary splits (as BCNF
+//decomposition produces). The successful joins are appended to joins.
+JoinTest testJoinBySplits(const set<AttrSet> &decompositions, const AttrSet &attributes, const FDSet &fdset, vector<pair<AttrSet,AttrSet>> &joins) {
+  STAT_PHASE(PHASE_LOSSLESS);
+
+  AttrSet covered;
+  for(auto &decomp: decompositions) {
+    if(decomp == attributes) return JOIN_LOSSLESS;
+    covered |= decomp;
+  }
+  //An attribute in no fragment keeps a non-distinguished symbol in every row
+  if(covered != attributes || decompositions.empty()) return JOIN_LOSSY;
+  if((int)decompositions.size() > MAX_SPLIT_FRAGMENTS) return JOIN_UNDECIDED;
+
+  ClosureEngine engine(fdset);
+  pmr::memory_resource *arena = RelationArena::current();
+  pmr::vector<AttrSet> fragments(decompositions.begin(), decompositions.end(), arena);
+  pmr::vector<char> alive(fragments.size(), 1, arena);
+  pmr::vector<pair<int,int>> pending(arena);
+  for(int i = 0; i<(int)fragments.size(); i++) {
+    for(int j = i + 1; j<(int)fragments.size(); j++) {
+      pending.push_back(make_pair(i, j));
+    }
+  }
+
+  //A pair that failed is only retried if one side has since grown, which
+  //is covered by the pairs queued for the merged fragment
+  while(!pending.empty()) {
+    int i = pending.back().first;
+    int j = pending.back().second;
+    pending.pop_back();
+    if(!alive[i] || !alive[j]) continue;
+
+    AttrSet closure = engine.getClosure(fragments[i] & fragments[j]);
+    if(!fragments[i].isSubsetOf(closure) && !fragments[j].isSubsetOf(closure)) continue;
+
+    joins.push_back(make_pair(fragments[i], fragments[j]));
+    alive[i] = alive[j] = 0;
+    fragments.push_back(fragments[i] | fragments[j]);
+    alive.push_back(1);
+    int k = fragments.size() - 1;
+    if(fragments[k] == attributes) return JOIN_LOSSLESS;
+    for(int other = 0; other<k; other++) {
+      if(alive[other]) pending.push_back(make_pair(other, k));
+    }
+  }
+
+  if(decompositions.size() == 2) return JOIN_LOSSY;
+  return JOIN_UNDECIDED;
+}
+
+void s_matrix::printState(ostream &out) {
+
+  out<<"Following decompositions are present with indices as mentioned:\n";
+  for(auto &decomp: decompositions) {
+    printSet(decomp, dictionary, out);
+    out<<" - "<<dmap[decomp]<<"\n";
+  }
+
+  out<<"Column number for attributes are as follows-\n";
+  for(int attr: attributes) {
+    out<<dictionary.getName(attr)<<" - "<<amap[attr]<<"\n";
+  }
+
+  out<<"S Matrix is as follows\n";
+  for(int i = 0; i<rows; i++) {
+    for(int j = 0; j<columns; j++){
+      out<<cellName(i, j)<<" ";
+    }
+    out<<"\n";
+  }
+
+}
+
+int s_matrix::find(int column, int sym) {
+  int *p = &parent[column * (rows + 1)];
+  int root = sym;
+  while(p[root] != root) root = p[root];
+  while(p[sym] != root) {
+    int next = p[sym];
+    p[sym] = root;
+    sym = next;
+  }
+  return root;
+}
+
+//The symbol in a cell as the textbook writes it: a<column> when
+//distinguished, b<row><column> otherwise
+string s_matrix::cellName(int row, int column) {
+  int sym = symbolAt(row, column);
+  if(sym == 0) return "a" + to_string(column);
+  return "b" + to_string(sym - 1) + to_string(column);
+}
+
+int s_matrix::symbolAt(int row, int column) {
+  return find(column, core[row * columns + column]);
+}
+
+//Applies the FDs until no more symbols can be equated or a row is all
+//distinguished. Every FD starts on the worklist; once applied it is only
+//queued again when a column of its LHS has had symbols merged, since
+//otherwise the groups of rows agreeing on the LHS have not changed.
+void s_matrix::chase(const FDSet &fdset) {
+  STAT_PHASE(PHASE_CHASE);
+
+  pmr::memory_resource *arena = RelationArena::current();
+  pmr::vector<const FD *> fds(arena);
+  pmr::vector<pmr::vector<int>> dependents(columns, pmr::vector<int>(arena), arena);
+  for(auto &dep: fdset) {
+    for(int x: dep.first) {
+      dependents[amap[x]].push_back(fds.size());
+    }
+    fds.push_back(&dep);
+  }
+
+  //A ring of FD indices; every FD is queued at most once
+  int n = fds.size();
+  pmr::vector<int> queue(arena);
+  pmr::vector<char> queued(n, 1, arena);
+  for(int i = 0; i<n; i++) queue.push_back(i);
+  int head = 0, pending = n;
+
+  while(pending > 0 && !complete) {
+    int i = queue[head];
+    head = (head + 1) % max(n, 1);
+    pending--;
+    queued[i] = 0;
+    STAT_ADD(STAT_CHASE_STEPS, 1);
+
+    int groups = groupRowsByX(fds[i]->first);
+    for(int g = 0; g<groups && !complete; g++) {
+      equateRows(fds[i]->second, &groupRows[groupStarts[g]], groupStarts[g + 1] - groupStarts[g]);
+    }
+
+    for(int c: changedColumns) {
+      columnChanged[c] = 0;
+      for(int j: dependents[c]) {
+        if(queued[j]) continue;
+        queued[j] = 1;
+        queue[(head + pending) % n] = j;
+        pending++;
+      }
+    }
+    changedColumns.clear();
+  }
+
+}
+
+bool s_matrix::hasAtypeRow(){
+  return complete;
+}
+
+//Counts the cells of a column holding sym (a root) as distinguished, for
+//rows about to have sym merged into the distinguished symbol
+void s_matrix::makeDistinguished(int column, int sym) {
+  for(int row = 0; row<rows; row++) {
+    if(symbolAt(row, column) != sym) continue;
+    if(++distinguished[row] == columns) complete = true;
+  }
+}
+
+//Equates the symbols of the given rows in every column of Y. As in the
+//textbook chase the distinguished symbol wins, otherwise the symbol of the
+//last row does. Columns with merged symbols are added to changedColumns.
+void s_matrix::equateRows(const AttrSet &Y, const int *rowIndices, int count) {
+
+  for(int y: Y) {
+    int column = amap[y];
+    int sym = symbolAt(rowIndices[count - 1], column);
+    for(int k = 0; k<count; k++) {
+      if(symbolAt(rowIndices[k], column) == 0) {
+        sym = 0;
+        break;
+      }
+    }
+    int *p = &parent[column * (rows + 1)];
+    for(int k = 0; k<count; k++) {
+      int current = symbolAt(rowIndices[k], column);
+      if(current == sym) continue;
+      if(sym == 0) makeDistinguished(column, current);
+      p[current] = sym;
+      STAT_ADD(STAT_CELLS_CHANGED, 1);
+      if(!columnChanged[column]) {
+        columnChanged[column] = 1;
+        changedColumns.push_back(column);
+      }
+    }
+  }
+
+}
+
+//Groups the rows that agree on X and returns the number of groups of at
+//least two rows. Group g is groupRows[groupStarts[g]] up to
+//groupStarts[g + 1], rows in ascending order, groups by their lowest row.
+//Rows are grouped by hashing their projection onto X into an open
+//addressing table of group heads.
+int s_matrix::groupRowsByX(const AttrSet &X) {
+
+  xcolumns.clear();
+  for(int x: X) xcolumns.push_back(amap[x]);
+
+  fill(slots.begin(), slots.end(), -1);
+  int mask = slots.size() - 1;
+  for(int i = 0; i<rows; i++) {
+    uint64_t h = 14695981039346656037ULL;
+    for(int c: xcolumns) {
+      h = (h ^ (uint64_t)symbolAt(i, c)) * 1099511628211ULL;
+    }
+    int slot = (h ^ (h >> 32)) & mask;
+    group[i] = i;
+    while(slots[slot] != -1) {
+      int head = slots[slot];
+      bool same = true;
+      for(int c: xcolumns) {
+        if(symbolAt(head, c) != symbolAt(i, c)) {
+          same = false;
+          break;
+        }
+      }
+      if(same) {
+        group[i] = head;
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+    if(group[i] == i) {
+      slots[slot] = i;
+      groupSize[i] = 0;
+    }
+    groupSize[group[i]]++;
+  }
+
+  //Lay the groups out one after the other. The head of a group that is
+  //laid out holds -(p + 1) in groupSize, p being the next free position.
+  int groups = 0, used = 0;
+  groupStarts.clear();
+  for(int i = 0; i<rows; i++) {
+    if(group[i] != i || groupSize[i] < 2) continue;
+    groupStarts.push_back(used);
+    used += groupSize[i];
+    groupSize[i] = -(groupStarts.back() + 1);
+    groups++;
+  }
+  groupStarts.push_back(used);
+  groupRows.resize(used);
+  for(int i = 0; i<rows; i++) {
+    int head = group[i];
+    if(groupSize[head] >= 0) continue;
+    groupRows[-groupSize[head] - 1] = i;
+    groupSize[head]--;
+  }
+  return groups;
+
+}
+
+
+s_matrix::s_matrix(const set<AttrSet> &decompositions, const AttrSet &attributes, const AttributeDictionary &dictionary)
+  : core(RelationArena::current()), parent(RelationArena::current()), amap(RelationArena::current()),
+    distinguished(RelationArena::current()), xcolumns(RelationArena::current()), slots(RelationArena::current()),
+    group(RelationArena::current()), groupSize(RelationArena::current()), groupRows(RelationArena::current()),
+    groupStarts(RelationArena::current()), columnChanged(RelationArena::current()),
+    changedColumns(RelationArena::current()), dictionary(dictionary) {
+  this->decompositions = decompositions;
+  this->attributes = attributes;
+  rows = decompositions.size();
+  columns = attributes.count();
+  amap.assign(dictionary.size(), -1);
+  int i = 0;
+  for(int attr : attributes) {
+    amap[attr] = i;
+    i++;
+  }
+
+  i = 0;
+  for(auto &decomp: decompositions) {
+    dmap[decomp] = i;
+    i++;
+  }
+
+  //The table of group heads is at most half full
+  int tableSize = 2;
+  while(tableSize < 2 * rows) tableSize *= 2;
+  xcolumns.reserve(columns);
+  slots.resize(tableSize);
+  group.resize(rows);
+  groupSize.resize(rows);
+  groupRows.reserve(rows);
+  groupStarts.reserve(rows + 1);
+  columnChanged.assign(columns, 0);
+  changedColumns.reserve(columns);
+
+  core.assign(rows * columns, 0);
+  parent.resize(columns * (rows + 1));
+  for(int j = 0; j<columns; j++) {
+    for(int sym = 0; sym<=rows; sym++) {
+      parent[j * (rows + 1) + sym] = sym;
+    }
+  }
+
+  distinguished.assign(rows, 0);
+  complete = false;
+  for(auto &decomp: decompositions) {
+    for(int attr: attributes){
+      if(!decomp.contains(attr)) {
+        core[dmap[decomp] * columns + amap[attr]] = dmap[decomp] + 1;
+      } else {
+        distinguished[dmap[decomp]]++;
+      }
+    }
+    if(distinguished[dmap[decomp]] == columns) complete = true;
+  }
+}
@@ -0,0 +1,219 @@
+/*
+	Reading relations from the input file format: a first line with the
+  comma separated attributes, followed by decompositions and functional
+  dependencies (lines containing "->"), one per line. A stream may hold
+  several such records separated by blank lines or "# name" headers.
+
+  Files are memory mapped and scanned in place. Attribute names are
+  upper-cased and stripped of spaces into one reused buffer and interned
+  straight away, so no string is allocated per token.
+*/
+
+#include <string>
+#include <string_view>
+#include <istream>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+MappedFile::MappedFile(const string &fileName) {
+  data = NULL;
+  length = 0;
+  opened = false;
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if(fd < 0) return;
+  struct stat info;
+  if(fstat(fd, &info) == 0 && !S_ISDIR(info.st_mode)) {
+    opened = true;
+    length = info.st_size;
+    if(length > 0) {
+      void *mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(mapped == MAP_FAILED) {
+        opened = false;
+        length = 0;
+      } else {
+        data = (const char *)mapped;
+      }
+    }
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if(data != NULL) munmap((void *)data, length);
+}
+
+//Returns the line starting at pos (without its newline) and moves pos past it
+static string_view nextLine(string_view text, size_t &pos) {
+  size_t end = text.find('\n', pos);
+  if(end == string_view::npos) end = text.size();
+  string_view line = text.substr(pos, end - pos);
+  pos = end + 1;
+  return line;
+}
+
+//Interns every comma separated name in list, after removing spaces (and
+//'>' when dropArrow is set) and upper-casing it into name
+static AttrSet encodeList(string_view list, bool dropArrow, AttributeDictionary &dictionary, string &name) {
+  AttrSet encoded;
+  size_t start = 0;
+  while(true) {
+    size_t end = list.find(',', start);
+    if(end == string_view::npos) end = list.size();
+    name.clear();
+    for(size_t i = start; i<end; i++) {
+      char c = list[i];
+      if(c == ' ' || c == '\t' || c == '\r' || (dropArrow && c == '>')) continue;
+      name.push_back(toupper((unsigned char)c));
+    }
+    encoded.insert(dictionary.intern(name));
+    if(end == list.size()) break;
+    start = end + 1;
+  }
+  return encoded;
+}
+
+//Parses the text of one relation: attributes first, then decompositions
+//and functional dependencies
+void parseRelationText(string_view text, RelationInput &input) {
+  STAT_PHASE(PHASE_PARSE);
+
+  AttributeDictionary &dictionary = input.dictionary;
+  string name;
+  size_t pos = 0;
+
+  //Number the attributes in name order so that ids follow name order
+  encodeList(nextLine(text, pos), false, dictionary, name);
+  dictionary.sortByName();
+  for(int i = 0; i<dictionary.size(); i++) {
+    input.attributes.insert(i);
+  }
+
+  while(pos < text.size()) {
+    string_view line = nextLine(text, pos);
+    size_t dash = line.find('-');
+    if(dash != string_view::npos) {
+      size_t end = line.find('-', dash + 1);
+      if(end == string_view::npos) end = line.size();
+      AttrSet x = encodeList(line.substr(0, dash), true, dictionary, name);
+      AttrSet y = encodeList(line.substr(dash + 1, end - dash - 1), true, dictionary, name);
+      input.fds.insert(make_pair(x, y));
+    } else {
+      input.decompositions.insert(encodeList(line, false, dictionary, name));
+    }
+  }
+}
+
+//Reads a relation from fileName into input; returns false if the file
+//cannot be opened
+bool readRelationFile(const string &fileName, RelationInput &input) {
+
+  MappedFile file(fileName);
+  if(!file.isOpen()) {
+    return false;
+  }
+  parseRelationText(file.getText(), input);
+  return true;
+}
+
+RelationReader::RelationReader(istream &in) {
+  this->in = &in;
+  offset = 0;
+  records = 0;
+  hasPendingName = false;
+}
+
+RelationReader::RelationReader(string_view text) {
+  this->in = NULL;
+  this->text = text;
+  offset = 0;
+  records = 0;
+  hasPendingName = false;
+}
+
+bool RelationReader::nextLine(string_view &line) {
+  if(in == NULL) {
+    if(offset >= text.size()) return false;
+    line = ::nextLine(text, offset);
+  } else {
+    if(!getline(*in, lineBuffer)) return false;
+    line = lineBuffer;
+  }
+  if(!line.empty() && line.back() == '\r') line.remove_suffix(1);
+  return true;
+}
+
+static bool isBlank(string_view line) {
+  return line.find_first_not_of(" \t") == string_view::npos;
+}
+
+static bool isHeader(string_view line, string &name) {
+  size_t start = line.find_first_not_of(" \t");
+  if(start == string_view::npos || line[start] != '#') return false;
+  line.remove_prefix(start + 1);
+  size_t first = line.find_first_not_of(" \t");
+  size_t last = line.find_last_not_of(" \t");
+  name = first == string_view::npos ? "" : string(line.substr(first, last - first + 1));
+  return true;
+}
+
+//Reads the next record. Only that record is held in memory: a mapped
+//record is parsed in place, a record from a stream is gathered into a
+//reused buffer. Returns false at the end of the input.
+bool RelationReader::next(string &name, RelationInput &input) {
+
+  string_view line;
+  string header;
+  bool named = hasPendingName;
+  name = pendingName;
+  hasPendingName = false;
+  size_t start = 0, end = 0;
+  bool empty = true;
+  recordBuffer.clear();
+
+  while(true) {
+    size_t lineStart = offset;
+    if(!nextLine(line)) break;
+    if(isHeader(line, header)) {
+      if(empty) {
+        name = header;
+        named = true;
+        continue;
+      }
+      pendingName = header;
+      hasPendingName = true;
+      break;
+    }
+    if(isBlank(line)) {
+      if(empty) continue;
+      break;
+    }
+    if(in == NULL) {
+      if(empty) start = lineStart;
+      end = lineStart + line.size();
+    } else {
+      recordBuffer.append(line);
+      recordBuffer.push_back('\n');
+    }
+    empty = false;
+  }
+
+  if(empty) return false;
+
+  records++;
+  if(!named) name = "relation " + to_string(records);
+  input = RelationInput();
+  if(in == NULL) {
+    parseRelationText(text.substr(start, end - start), input);
+  } else {
+    parseRelationText(recordBuffer, input);
+  }
+  return true;
+}
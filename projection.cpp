@@ -0,0 +1,122 @@
+/*
+	Projection of a set of functional dependencies onto a fragment of the
+  relation: the FDs X -> Y implied by F with X, Y inside the fragment.
+
+  Candidate LHS sets are enumerated level by level (by size) and only
+  the following are extended:
+  - sets of attributes that occur on the LHS of some FD, since any other
+    attribute only determines itself;
+  - sets that are not yet a superkey of the fragment, since supersets of a
+    superkey only yield implied FDs;
+  - sets with no attribute implied by the others, since otherwise the
+    smaller set already yields the same FD.
+  A set is only generated if all its subsets one attribute smaller
+  survived. Closures are computed under F, so they are cached once and
+  shared by the projections onto every fragment.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+ProjectionEngine::ProjectionEngine(const FDSet &fdset) : engine(fdset) {
+  for(auto &dep: fdset) {
+    lhsAttributes |= dep.first;
+  }
+}
+
+//Map nodes stay in place when the map grows, so the returned reference
+//remains valid while other threads insert
+const AttrSet &ProjectionEngine::closureOf(const AttrSet &X) {
+  {
+    lock_guard<mutex> guard(cacheLock);
+    auto itr = closures.find(X);
+    if(itr != closures.end()) return itr->second;
+  }
+  AttrSet closure = engine.getClosure(X);
+  lock_guard<mutex> guard(cacheLock);
+  return closures.emplace(X, closure).first->second;
+}
+
+//Returns a minimal cover of the projection of F onto fragment
+FDSet ProjectionEngine::project(const AttrSet &fragment) {
+  STAT_PHASE(PHASE_PROJECTION);
+
+  {
+    lock_guard<mutex> guard(cacheLock);
+    auto cached = projections.find(fragment);
+    if(cached != projections.end()) return cached->second;
+  }
+
+  FDSet projected;
+  vector<int> candidates;
+  for(int attr: fragment & lhsAttributes) candidates.push_back(attr);
+
+  //Sets with an empty LHS are implied by every other
+  AttrSet emptySet;
+  AttrSet implied = (closureOf(emptySet) & fragment);
+  if(!implied.empty()) projected.insert(make_pair(emptySet, implied));
+
+  //Each level holds the surviving sets of one size together with the
+  //largest attribute in each, so that extensions are generated once
+  vector<pair<AttrSet,int>> level;
+  unordered_set<AttrSet, AttrSetHash> alive;
+  level.push_back(make_pair(emptySet, -1));
+  alive.insert(emptySet);
+
+  while(!level.empty()) {
+    vector<pair<AttrSet,int>> nextLevel;
+    unordered_set<AttrSet, AttrSetHash> nextAlive;
+
+    for(auto &entry: level) {
+      const AttrSet &X = entry.first;
+      for(int attr: candidates) {
+        if(attr <= entry.second) continue;
+
+        AttrSet Z = X;
+        Z.insert(attr);
+
+        //Every subset one smaller must have survived, and no attribute of
+        //Z may follow from the others
+        bool keep = true;
+        for(int z: Z) {
+          AttrSet sub = Z;
+          sub.erase(z);
+          if(!alive.count(sub)) {
+            keep = false;
+            break;
+          }
+          if(closureOf(sub).contains(z)) {
+            keep = false;
+            break;
+          }
+        }
+        if(!keep) continue;
+
+        const AttrSet &closure = closureOf(Z);
+        AttrSet determined = (closure & fragment) - Z - implied;
+        if(!determined.empty()) {
+          projected.insert(make_pair(Z, determined));
+        }
+        if(!fragment.isSubsetOf(closure)) {
+          nextLevel.push_back(make_pair(Z, attr));
+          nextAlive.insert(Z);
+        }
+      }
+    }
+
+    level.swap(nextLevel);
+    alive.swap(nextAlive);
+  }
+
+  minimize(projected);
+  lock_guard<mutex> guard(cacheLock);
+  projections[fragment] = projected;
+  return projected;
+}
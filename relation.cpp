@@ -0,0 +1,618 @@
+/*
+	Attribute closure, minimal cover and key computation, and the Relation
+  class built on top of them.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+//Closures under fewer FDs than this are not cached
+static const int MIN_CACHED_FDS = 64;
+
+//FD sets over more words than this use LinClosure instead of the kernel
+static const int MAX_KERNEL_WORDS = 4;
+
+//Every kernel pass tests all FDs, so closing over a derivation chain (one
+//FD firing the next) costs a pass per link, while LinClosure pays once per
+//FD and then per index entry of the attributes added. The first
+//KERNEL_SAMPLE closures of an engine are computed by the kernel and also
+//priced for LinClosure, in units of one FD word tested in a pass; the
+//cheaper of the two then computes the rest.
+static const int KERNEL_SAMPLE = 32;
+static const int LINEAR_FD_COST = 16;
+static const int LINEAR_SCAN_COST = 45;
+
+//The engine's tables live in the current arena
+ClosureEngine::ClosureEngine()
+  : lhs(RelationArena::current()), rhs(RelationArena::current()), lhsSize(RelationArena::current()),
+    disabled(RelationArena::current()), index(RelationArena::current()), fdHash(RelationArena::current()) {
+  version = 0;
+  sampled = 0;
+  kernelWork = 0;
+  linearWork = 0;
+}
+
+ClosureEngine::ClosureEngine(const FDSet &fdset) : ClosureEngine() {
+  for(auto &dep: fdset) {
+    addFD(dep);
+  }
+  buildColumns();
+}
+
+ClosureEngine::ClosureEngine(const vector<FD> &fds) : ClosureEngine() {
+  for(auto &dep: fds) {
+    addFD(dep);
+  }
+  buildColumns();
+}
+
+void ClosureEngine::addFD(const FD &dep) {
+  int i = lhs.size();
+  lhs.push_back(dep.first);
+  rhs.push_back(dep.second);
+  lhsSize.push_back(dep.first.count());
+  disabled.push_back(0);
+  fdHash.push_back(0);
+  rehashFD(i);
+  for(int attr: dep.first) {
+    if(attr >= (int)index.size()) index.resize(attr + 1);
+    index[attr].push_back(i);
+  }
+}
+
+void ClosureEngine::buildColumns() {
+  int words = 0;
+  for(int i = 0; i<size(); i++) {
+    words = max(words, max(lhs[i].words(), rhs[i].words()));
+  }
+  columns.reset(size(), words);
+  for(int i = 0; i<size(); i++) {
+    columns.setLHS(i, lhs[i]);
+    columns.setRHS(i, rhs[i]);
+  }
+}
+
+//The fingerprint is the sum of the hashes of the enabled FDs, so it does
+//not depend on their order and is updated in constant time on every edit
+static uint64_t hashFD(const AttrSet &X, const AttrSet &Y) {
+  uint64_t h = X.hash() * 0x9e3779b97f4a7c15ULL + Y.hash();
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+void ClosureEngine::rehashFD(int i) {
+  if(!disabled[i]) version -= fdHash[i];
+  fdHash[i] = hashFD(lhs[i], rhs[i]);
+  if(!disabled[i]) version += fdHash[i];
+}
+
+//Replaces the LHS of FD i by a subset of it. Index entries of the dropped
+//attributes stay behind and are skipped by getClosure.
+void ClosureEngine::setLHS(int i, const AttrSet &X) {
+  lhs[i] = X;
+  lhsSize[i] = X.count();
+  columns.setLHS(i, X);
+  rehashFD(i);
+}
+
+void ClosureEngine::setEnabled(int i, bool enabled) {
+  if(enabled == !disabled[i]) return;
+  disabled[i] = !enabled;
+  columns.setRHS(i, enabled ? rhs[i] : AttrSet());
+  if(enabled) {
+    version += fdHash[i];
+  } else {
+    version -= fdHash[i];
+  }
+}
+
+//Closure of X; the FD at position skip and disabled FDs are ignored.
+//Closures are looked up in and added to the thread's closure cache,
+//except under FD sets small enough that a lookup costs about as much.
+AttrSet ClosureEngine::getClosure(const AttrSet &X, int skip) {
+  STAT_ADD(STAT_CLOSURES, 1);
+  if(size() < MIN_CACHED_FDS) return computeClosure(X, skip);
+
+  uint64_t key = version;
+  if(skip >= 0 && !disabled[skip]) key -= fdHash[skip];
+
+  ClosureCache &cache = ClosureCache::local();
+  AttrSet closure, seed;
+  if(cache.lookupClosure(key, X, closure, seed)) return closure;
+
+  closure = computeClosure(seed.empty() ? X : seed, skip);
+  cache.insert(key, X, closure);
+  return closure;
+}
+
+AttrSet ClosureEngine::computeClosure(const AttrSet &X, int skip) {
+  bool linear = sampled.load(memory_order_acquire) >= KERNEL_SAMPLE && kernelWork > linearWork;
+  if(columns.words <= MAX_KERNEL_WORDS && !linear) {
+    uint64_t closure[MAX_KERNEL_WORDS];
+    for(int w = 0; w<columns.words; w++) {
+      closure[w] = X.word(w);
+    }
+    int passes = closeOverColumns(columns, closure, skip);
+    AttrSet Xp = X;
+    Xp.insertWords(closure, columns.words);
+    //Threads sharing the engine may sample a few closures more than
+    //KERNEL_SAMPLE between them, which only refines the estimate
+    if(sampled.load(memory_order_relaxed) < KERNEL_SAMPLE) {
+      long scans = 0;
+      for(int attr: Xp) {
+        if(attr < (int)index.size()) scans += index[attr].size();
+      }
+      kernelWork += (long)passes * columns.stride * columns.words;
+      linearWork += (long)LINEAR_FD_COST * size() + LINEAR_SCAN_COST * scans;
+      sampled.fetch_add(1, memory_order_release);
+    }
+    return Xp;
+  }
+  return linearClosure(X, skip);
+}
+
+AttrSet ClosureEngine::linearClosure(const AttrSet &X, int skip) {
+  AttrSet Xp = X;
+  long scans = 0;
+  vector<int> remaining(lhsSize.begin(), lhsSize.end());
+  vector<int> pending;
+  for(int attr: X) pending.push_back(attr);
+
+  auto fire = [&](int i) {
+    if(i == skip || disabled[i]) return;
+    AttrSet added = rhs[i] - Xp;
+    Xp |= added;
+    for(int attr: added) pending.push_back(attr);
+  };
+
+  for(int i = 0; i<(int)remaining.size(); i++) {
+    if(remaining[i] == 0) fire(i);
+  }
+
+  while(!pending.empty()) {
+    int attr = pending.back();
+    pending.pop_back();
+    if(attr >= (int)index.size()) continue;
+    scans += index[attr].size();
+    for(auto i: index[attr]) {
+      if(lhs[i].contains(attr) && --remaining[i] == 0) fire(i);
+    }
+  }
+  STAT_ADD(STAT_FD_SCANS, scans);
+
+  return Xp;
+}
+
+//The two passes of minimize: extraneous LHS attributes are dropped from
+//the FDs of engine at positions (in that order), then every enabled FD
+//that is redundant is disabled. A narrowed LHS can make an FD it relied
+//on redundant, so the second pass looks at all of them.
+static void reduceFDs(ClosureEngine &engine, const vector<int> &positions) {
+
+  //Remove extraneous attributes. Dropping an extraneous attribute leaves
+  //an equivalent FD set, so closures (and hence the test for every other
+  //attribute) are unaffected and a single sweep is enough. Every LHS is
+  //tested down to the empty set, which FDs with an empty LHS (constants)
+  //can make extraneous too.
+  //The attributes are taken from a copy, since setLHS replaces the LHS.
+  for(int i: positions) {
+    const AttrSet original = engine.getLHS(i);
+    AttrSet lhs = original;
+    for(int attr: original) {
+      AttrSet part2 = lhs;
+      part2.erase(attr);
+      AttrSet closure = engine.getClosure(part2);
+      if(engine.getRHS(i).isSubsetOf(closure)) {
+        lhs = part2;
+        engine.setLHS(i, lhs);
+      }
+    }
+  }
+
+  //Remove dependencies achievable by transitivity. They are dropped one
+  //at a time, so every test runs against a set equivalent to the original.
+  for(int i = 0; i<engine.size(); i++) {
+    if(!engine.isEnabled(i)) continue;
+    engine.setEnabled(i, false);
+    AttrSet closure = engine.getClosure(engine.getLHS(i));
+    if(!engine.getRHS(i).isSubsetOf(closure)) {
+      engine.setEnabled(i, true);
+    }
+  }
+}
+
+//Adds the FDs still enabled in engine to fdset
+static void collectFDs(const ClosureEngine &engine, FDSet &fdset) {
+  for(int i = 0; i<engine.size(); i++) {
+    if(engine.isEnabled(i)) {
+      fdset.insert(make_pair(engine.getLHS(i), engine.getRHS(i)));
+    }
+  }
+}
+
+Relation::Relation(const AttributeDictionary &dictionary, const AttrSet &attributes, const set<AttrSet> &decompositions, const FDSet &fds) {
+
+  //Check if decompositions are valid
+  for(auto &decomposition: decompositions) {
+    if(!decomposition.isSubsetOf(attributes)){
+      throw RelationError("ERROR: All decompositions must be subset of the relation");
+    }
+  }
+
+  //Check if fds are valid
+  for(auto &tuple : fds) {
+    if(!tuple.first.isSubsetOf(attributes)){
+      throw RelationError("ERROR: All functional dependencies must be defined on the relation");
+    }
+    if(!tuple.second.isSubsetOf(attributes)){
+      throw RelationError("ERROR: All functional dependencies must be defined on the relation");
+    }
+  }
+
+  this->dictionary = dictionary;
+  this->attributes = attributes;
+  this->decompositions = decompositions;
+  this->declared = fds;
+  this->fds = fds;
+  STAT_ADD(STAT_RELATIONS, 1);
+  minimize(this->fds);
+  this->key = findKey(this->fds, attributes);
+}
+
+Relation::Relation(const RelationInput &input)
+  : Relation(input.dictionary, input.attributes, input.decompositions, input.fds) {
+}
+
+//A relation whose minimal cover and key are already known, e.g. from a
+//schema cache. Only the decompositions are checked.
+Relation::Relation(const RelationInput &input, const FDSet &cover, const AttrSet &key) {
+
+  for(auto &decomposition: input.decompositions) {
+    if(!decomposition.isSubsetOf(input.attributes)){
+      throw RelationError("ERROR: All decompositions must be subset of the relation");
+    }
+  }
+
+  this->dictionary = input.dictionary;
+  this->attributes = input.attributes;
+  this->decompositions = input.decompositions;
+  this->declared = input.fds;
+  this->fds = cover;
+  this->key = key;
+  STAT_ADD(STAT_RELATIONS, 1);
+}
+
+const AttributeDictionary &Relation::getDictionary() const {
+  return this->dictionary;
+}
+
+const AttrSet &Relation::getAttributes() const {
+  return this->attributes;
+}
+  
+const FDSet &Relation::getFDS() const {
+  return this->fds;
+}
+
+const FDSet &Relation::getDeclaredFDs() const {
+  return this->declared;
+}
+
+const set<AttrSet> &Relation::getDecompositions() const {
+  return this->decompositions;
+}
+
+const AttrSet &Relation::getKey() const {
+  return this->key;
+}
+
+void Relation::setDecompositions(const set<AttrSet> &decompositions) {
+  this->decompositions = decompositions;
+}
+
+//Makes key a key again after the FDs or attributes changed. Attributes
+//no longer in the relation are dropped and the ones it stopped
+//determining are added back; with shrink, attributes the new FDs made
+//redundant are removed as well. Without shrink a key that still
+//determines everything is left alone: FDs were only taken away, so none
+//of its subsets can have become a superkey.
+void Relation::updateKey(ClosureEngine &engine, bool shrink) {
+  AttrSet superkey = this->key & this->attributes;
+  AttrSet missing = this->attributes - engine.getClosure(superkey);
+  if(missing.empty() && !shrink) {
+    this->key = superkey;
+    return;
+  }
+  superkey |= missing;
+  this->key = reduceToKey(engine, superkey, this->attributes, superkey);
+}
+
+//Adds X -> Y to the declared FDs. Returns false if the cover already
+//implies it, leaving the cover as it is. Only the
+//FDs that can use the new ones, those whose LHS closure now contains X,
+//can have gained extraneous attributes: closures of sets that do not
+//reach X are unchanged.
+bool Relation::addFD(const FD &dep) {
+  STAT_PHASE(PHASE_MINIMIZE);
+
+  if(!dep.first.isSubsetOf(this->attributes) || !dep.second.isSubsetOf(this->attributes)) {
+    throw RelationError("ERROR: All functional dependencies must be defined on the relation");
+  }
+  this->declared.insert(dep);
+
+  //The new FDs, one per attribute, go after the cover and are only
+  //enabled if the cover does not imply them already
+  vector<FD> deps(this->fds.begin(), this->fds.end());
+  int n = deps.size();
+  for(int attr: dep.second - dep.first) {
+    AttrSet temp;
+    temp.insert(attr);
+    deps.push_back(make_pair(dep.first, temp));
+  }
+  ClosureEngine engine(deps);
+  for(int i = n; i<engine.size(); i++) {
+    engine.setEnabled(i, false);
+  }
+  AttrSet closure = engine.getClosure(dep.first);
+  vector<int> added;
+  for(int i = n; i<engine.size(); i++) {
+    if(!engine.getRHS(i).isSubsetOf(closure)) {
+      engine.setEnabled(i, true);
+      added.push_back(i);
+    }
+  }
+  if(added.empty()) return false;
+
+  vector<int> positions;
+  for(int i = 0; i<n; i++) {
+    if(dep.first.isSubsetOf(engine.getClosure(engine.getLHS(i)))) {
+      positions.push_back(i);
+    }
+  }
+  positions.insert(positions.end(), added.begin(), added.end());
+  reduceFDs(engine, positions);
+
+  this->fds.clear();
+  collectFDs(engine, this->fds);
+  updateKey(engine, true);
+  return true;
+}
+
+//Removes X -> Y from the declared FDs: Y leaves the RHS of every
+//declared FD with LHS X, and FDs left with an empty RHS are dropped.
+//Returns false if no declared FD had any of Y on its RHS. The cover is
+//rebuilt from the declared FDs that are left, since an FD of the cover may
+//stand in for declared ones minimize dropped, or may not be declared at
+//all. Closures only shrink, so the key only needs to grow if it lost its
+//closure.
+bool Relation::removeFD(const FD &dep) {
+  bool removed = false;
+  FDSet remaining;
+  for(auto &declaredDep: this->declared) {
+    if(declaredDep.first == dep.first && declaredDep.second.intersects(dep.second)) {
+      removed = true;
+      AttrSet rest = declaredDep.second - dep.second;
+      if(!rest.empty()) remaining.insert(make_pair(declaredDep.first, rest));
+    } else {
+      remaining.insert(declaredDep);
+    }
+  }
+  if(!removed) return false;
+
+  this->declared = remaining;
+  this->fds = remaining;
+  minimize(this->fds);
+  ClosureEngine engine(this->fds);
+  updateKey(engine, false);
+  return true;
+}
+
+//Adds an attribute no FD mentions yet; it joins the key, which is all
+//that changes. Returns its id.
+int Relation::addAttribute(const string &name) {
+  int attr = this->dictionary.intern(name);
+  if(this->attributes.contains(attr)) {
+    throw RelationError("ERROR: Attribute " + name + " already exists in the relation");
+  }
+  this->attributes.insert(attr);
+  this->key.insert(attr);
+  return attr;
+}
+
+//Drops an attribute, keeping what the FDs imply about the others (the
+//projection of F onto the rest). FDs that do not mention it stay as they
+//are. Each Z -> b with the attribute in Z is combined with every W -> A
+//deriving it into (Z - A) W -> b. Closures in the projection are the
+//old ones without the attribute, so only these new FDs can have
+//extraneous attributes. The declared FDs are projected the same way.
+//Fragments lose the attribute and empty ones are dropped.
+void Relation::dropAttribute(const string &name) {
+  STAT_PHASE(PHASE_MINIMIZE);
+
+  int attr = this->dictionary.find(name);
+  if(attr < 0 || !this->attributes.contains(attr)) {
+    throw RelationError("ERROR: Attribute " + name + " doesn't exist in the relation");
+  }
+  this->attributes.erase(attr);
+
+  set<AttrSet> fragments;
+  for(auto decomposition: this->decompositions) {
+    decomposition.erase(attr);
+    if(!decomposition.empty()) fragments.insert(decomposition);
+  }
+  this->decompositions = fragments;
+
+  vector<FD> deps, users, deriving;
+  for(auto &dep: this->fds) {
+    if(dep.second.contains(attr)) {
+      deriving.push_back(dep);
+    } else if(dep.first.contains(attr)) {
+      users.push_back(dep);
+    } else {
+      deps.push_back(dep);
+    }
+  }
+
+  FDSet combined;
+  for(auto &dep: users) {
+    AttrSet Z = dep.first;
+    Z.erase(attr);
+    for(auto &source: deriving) {
+      AttrSet X = Z | source.first;
+      if(!dep.second.isSubsetOf(X) && !this->fds.count(make_pair(X, dep.second))) {
+        combined.insert(make_pair(X, dep.second));
+      }
+    }
+  }
+
+  int n = deps.size();
+  deps.insert(deps.end(), combined.begin(), combined.end());
+  ClosureEngine engine(deps);
+  vector<int> positions;
+  for(int i = n; i<engine.size(); i++) {
+    positions.push_back(i);
+  }
+  reduceFDs(engine, positions);
+
+  this->fds.clear();
+  collectFDs(engine, this->fds);
+  updateKey(engine, true);
+
+  FDSet declaredDeps;
+  vector<FD> readers;
+  for(auto &dep: this->declared) {
+    AttrSet Y = dep.second;
+    Y.erase(attr);
+    if(Y.empty()) continue;
+    if(dep.first.contains(attr)) {
+      readers.push_back(make_pair(dep.first, Y));
+    } else {
+      declaredDeps.insert(make_pair(dep.first, Y));
+    }
+  }
+  for(auto &dep: readers) {
+    AttrSet Z = dep.first;
+    Z.erase(attr);
+    for(auto &source: this->declared) {
+      if(!source.second.contains(attr) || source.first.contains(attr)) continue;
+      AttrSet X = Z | source.first;
+      AttrSet Y = dep.second - X;
+      if(!Y.empty()) declaredDeps.insert(make_pair(X, Y));
+    }
+  }
+  this->declared = declaredDeps;
+}
+
+void Relation::printRelInfo(ostream &out) const {
+  out<<"---------------\n";
+  out<<"Attributes:\n";
+  printSet(attributes, dictionary, out);
+  out<<"\nKey - ";
+  printSet(key, dictionary, out);
+  out<<"\nFDs\n";
+  printFD(fds, dictionary, out);
+  out<<"---------------\n";
+}
+
+void printSet(const AttrSet &s, const AttributeDictionary &dictionary, ostream &out) {
+  for(int attr: s){
+    out<<dictionary.getName(attr)<<" ";
+  }
+}
+
+void printFD(const FDSet &fdset, const AttributeDictionary &dictionary, ostream &out) {
+  for(auto &tuple: fdset) {
+    for(int attr : tuple.first) {
+      out<<dictionary.getName(attr)<<" ";
+    }
+    out<<"-> ";
+    for(int attr : tuple.second) {
+      out<<dictionary.getName(attr)<<" ";
+    }
+    out<<"\n";
+  }
+}
+
+AttrSet getClosure(const AttrSet &X, const AttrSet &attributes, const FDSet &fdset){
+  if(!X.isSubsetOf(attributes)) {
+    throw RelationError("CLOSURE ERROR: The attribute doesn't exist");
+  }
+
+  ClosureEngine engine(fdset);
+  return engine.getClosure(X);
+}
+
+
+void minimize(FDSet &fdset) {
+  STAT_PHASE(PHASE_MINIMIZE);
+
+  //Making RHS of FD a single attribute  
+  vector<FD> unfurled;
+  for(auto &tuple : fdset){
+    for(int element: tuple.second){
+      AttrSet temp;
+      temp.insert(element);
+      unfurled.push_back(make_pair(tuple.first, temp));
+    }
+  }
+  sort(unfurled.begin(), unfurled.end());
+  unfurled.erase(unique(unfurled.begin(), unfurled.end()), unfurled.end());
+
+  //One closure index is kept for the whole computation; reductions and
+  //removals are applied to it in place
+  ClosureEngine engine(unfurled);
+  vector<int> positions(engine.size());
+  for(int i = 0; i<engine.size(); i++) {
+    positions[i] = i;
+  }
+  reduceFDs(engine, positions);
+
+  fdset.clear();
+  collectFDs(engine, fdset);
+}
+
+AttrSet findKey(const FDSet &fdset, const AttrSet &attributes) {
+  STAT_PHASE(PHASE_FINDKEY);
+
+  AttrSet key = attributes;
+  ClosureEngine engine(fdset);
+  int flag = 1;
+  while(flag != 0) {
+    flag = 0;
+    for(int attr: key) {
+      AttrSet temp = key;
+      temp.erase(attr);
+      AttrSet closure = engine.getClosure(temp);
+      if(closure == attributes) {
+        key.erase(attr);
+        flag = 1;
+        break;
+      }
+    } 
+  }
+  return key;
+}
+
+bool isSubsetOf(const AttrSet &a, const AttrSet &b) {
+  return a.isSubsetOf(b);
+}
+
+
+void subtractSets(const AttrSet &a, const AttrSet &b, AttrSet &c) {
+  c = a - b;
+}
+
+void uniteSets(const AttrSet &a, const AttrSet &b, AttrSet &c) {
+  c = a | b;
+}
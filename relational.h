@@ -0,0 +1,441 @@
+/*
+	Shared normalization library used by the lj, 3nf and bcnf tools:
+  relation parsing, attribute closure, minimal cover, key finding,
+  the lossless join test and the BCNF / 3NF synthesis algorithms.
+*/
+
+#ifndef RELATIONAL_H
+#define RELATIONAL_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <set>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <memory_resource>
+#include <stdexcept>
+#include <cstdint>
+#include "attrset.h"
+
+using namespace std;
+
+//Raised for invalid input; the message is what the tools print before exiting
+class RelationError : public runtime_error {
+  public:
+  RelationError(const string &message) : runtime_error(message) {}
+};
+
+//Arena for the intermediate structures of one relation's analysis
+//(arena.cpp). While it is alive it is the current arena of the thread
+//that created it: closure engines, the S matrix and the other structures
+//built on that thread take their memory from current(), in a few large
+//blocks released together when the arena is destroyed. Nothing allocated
+//from it may outlive it or be grown on another thread.
+class RelationArena {
+  private:
+  static const size_t INLINE_BYTES = 16384;
+  alignas(max_align_t) char buffer[INLINE_BYTES];
+  pmr::monotonic_buffer_resource blocks;
+  RelationArena *previous;
+
+  public:
+  RelationArena();
+  ~RelationArena();
+  RelationArena(const RelationArena &) = delete;
+  RelationArena &operator=(const RelationArena &) = delete;
+  static pmr::memory_resource *current();
+};
+
+//A relation as read from an input file, before minimization
+struct RelationInput {
+  AttributeDictionary dictionary;
+  AttrSet attributes;
+  set<AttrSet> decompositions;
+  FDSet fds;
+};
+
+//Parsing (parser.cpp)
+//A read-only memory mapping of a whole file
+class MappedFile {
+  private:
+  const char *data;
+  size_t length;
+  bool opened;
+
+  public:
+  MappedFile(const string &fileName);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  bool isOpen() const { return opened; }
+  string_view getText() const { return string_view(data, length); }
+};
+
+void parseRelationText(string_view text, RelationInput &input);
+bool readRelationFile(const string &fileName, RelationInput &input);
+
+//FD discovery from table contents (discovery.cpp). The first line of a
+//CSV or TSV table (tab separated if the header holds a tab) names the
+//columns, which become the attributes; the FDs are every minimal
+//non-trivial FD that holds in the rows. Products of partitions are
+//computed on threads workers.
+void discoverRelationText(string_view text, int threads, RelationInput &input);
+bool discoverRelationFile(const string &fileName, int threads, RelationInput &input);
+
+//Reads relations one at a time from a stream or a mapped file holding
+//several of them. Records are separated by blank lines; a record may
+//start with a "# name" line, which also ends the previous record.
+//Unnamed records are called "relation <n>".
+class RelationReader {
+  private:
+  istream *in;
+  string_view text;
+  size_t offset;
+  string lineBuffer;
+  string recordBuffer;
+  string pendingName;
+  bool hasPendingName;
+  int records;
+  bool nextLine(string_view &line);
+
+  public:
+  RelationReader(istream &in);
+  RelationReader(string_view text);
+  bool next(string &name, RelationInput &input);
+};
+
+//Closure, cover and key computation (relation.cpp)
+void printSet(const AttrSet &s, const AttributeDictionary &dictionary, ostream &out = cout);
+void printFD(const FDSet &fdset, const AttributeDictionary &dictionary, ostream &out = cout);
+AttrSet getClosure(const AttrSet &X, const AttrSet &attributes, const FDSet &fdset);
+void minimize(FDSet &fdset);
+AttrSet findKey(const FDSet &fdset, const AttrSet &attributes);
+bool isSubsetOf(const AttrSet &a, const AttrSet &b);
+void subtractSets(const AttrSet &a, const AttrSet &b, AttrSet &c);
+void uniteSets(const AttrSet &a, const AttrSet &b, AttrSet &c);
+
+//Per-thread LRU cache of closures, keyed by the fingerprint of an FD set
+//and the set whose closure was taken (closurecache.cpp). Hits answered
+//from the closure of a subset X - a are counted as subset hits.
+struct ClosureCacheStats {
+  long hits;
+  long subsetHits;
+  long misses;
+};
+
+class ClosureCache {
+  private:
+  typedef pair<uint64_t, AttrSet> Key;
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+  list<pair<Key, AttrSet>> entries;
+  unordered_map<Key, list<pair<Key, AttrSet>>::iterator, KeyHash> lookup;
+  size_t capacity;
+  const AttrSet *find(uint64_t version, const AttrSet &X);
+
+  public:
+  ClosureCache(size_t capacity);
+  static ClosureCache &local();
+  void setCapacity(size_t capacity);
+  bool lookupClosure(uint64_t version, const AttrSet &X, AttrSet &closure, AttrSet &seed);
+  void insert(uint64_t version, const AttrSet &X, const AttrSet &closure);
+};
+
+void setClosureCacheCapacity(size_t entries);
+ClosureCacheStats getClosureCacheStats();
+
+//FDs laid out column-wise for the bitset closure kernel (closurekernel.cpp):
+//word w of the LHS (RHS) of FD i is lhs[w * stride + i] (rhs[...]), so a
+//block of FDs is tested against the closure with a few wide loads.
+//Disabled FDs get an empty RHS and never fire.
+struct FDColumns {
+  static const int FD_BLOCK = 8;
+  int words;
+  int count;
+  int stride;
+  pmr::vector<uint64_t> lhs;
+  pmr::vector<uint64_t> rhs;
+  FDColumns();
+  void reset(int n, int words);
+  void setLHS(int i, const AttrSet &X);
+  void setRHS(int i, const AttrSet &Y);
+};
+
+int closeOverColumns(const FDColumns &fds, uint64_t *closure, int skip);
+bool selectClosureKernel(const string &name);
+const char *closureKernelName();
+
+//Computes attribute closures. FD sets over at most 256 attributes are
+//closed by the bitset kernel over FDColumns; wider ones in time linear in
+//the size of the FD set (LinClosure): every FD keeps a count of LHS
+//attributes not yet in the closure and fires once that count reaches
+//zero. The kernel takes a pass per link of a derivation chain, so an
+//engine switches to LinClosure when its first closures show that to be
+//cheaper. FDs are addressed by position and can be narrowed or disabled
+//in place, so callers that edit a cover keep the index instead of
+//rebuilding it. getClosure may run on several threads at once, the
+//edits may not. The engine keeps a
+//fingerprint of its enabled FDs, its version in the closure cache.
+class ClosureEngine {
+  private:
+  pmr::vector<AttrSet> lhs;
+  pmr::vector<AttrSet> rhs;
+  pmr::vector<int> lhsSize;
+  pmr::vector<char> disabled;
+  pmr::vector<pmr::vector<int>> index;
+  pmr::vector<uint64_t> fdHash;
+  uint64_t version;
+  FDColumns columns;
+  atomic<int> sampled;
+  atomic<long> kernelWork;
+  atomic<long> linearWork;
+  ClosureEngine();
+  void addFD(const FD &dep);
+  void buildColumns();
+  void rehashFD(int i);
+  AttrSet computeClosure(const AttrSet &X, int skip);
+  AttrSet linearClosure(const AttrSet &X, int skip);
+
+  public:
+  ClosureEngine(const FDSet &fdset);
+  ClosureEngine(const vector<FD> &fds);
+  ClosureEngine(const ClosureEngine &) = delete;
+  ClosureEngine &operator=(const ClosureEngine &) = delete;
+  int size() const { return lhs.size(); }
+  const AttrSet &getLHS(int i) const { return lhs[i]; }
+  const AttrSet &getRHS(int i) const { return rhs[i]; }
+  void setLHS(int i, const AttrSet &X);
+  void setEnabled(int i, bool enabled);
+  bool isEnabled(int i) const { return !disabled[i]; }
+  AttrSet getClosure(const AttrSet &X, int skip = -1);
+};
+
+class Relation {
+  private:
+  AttributeDictionary dictionary;
+  AttrSet attributes;
+  FDSet declared;
+  FDSet fds;
+  set<AttrSet> decompositions;
+  AttrSet key;
+  void updateKey(ClosureEngine &engine, bool shrink);
+
+  public:
+  void printRelInfo(ostream &out = cout) const;
+  const AttributeDictionary &getDictionary() const;
+  const AttrSet &getKey() const;
+  const AttrSet &getAttributes() const;
+  const FDSet &getFDS() const;
+  const FDSet &getDeclaredFDs() const;
+  const set<AttrSet> &getDecompositions() const;
+  void setDecompositions(const set<AttrSet> &decompositions);
+
+  //Edits that keep the minimal cover and the key up to date, redoing only
+  //the part of minimize and findKey the change can affect. addFD and
+  //removeFD edit the FDs as declared (getDeclaredFDs), whose minimal
+  //cover getFDS returns. The cover
+  //stays minimal but need not be the one minimize would give for the
+  //edited FD set from scratch. New attributes get the next free id, after
+  //the ones in name order.
+  bool addFD(const FD &dep);
+  bool removeFD(const FD &dep);
+  int addAttribute(const string &name);
+  void dropAttribute(const string &name);
+
+  Relation(const AttributeDictionary &dictionary, const AttrSet &attributes, const set<AttrSet> &decompositions, const FDSet &fds);
+  Relation(const RelationInput &input);
+  Relation(const RelationInput &input, const FDSet &cover, const AttrSet &key);
+};
+
+//Minimal covers and keys of the schemas (attributes and FDs) analyzed so
+//far, shared by all threads of a server (schemacache.cpp). Entries are
+//keyed by the attribute names and the FDs, so a schema sent again with
+//other decompositions is not minimized again. Least recently used
+//entries are evicted.
+struct SchemaCacheStats {
+  long hits;
+  long misses;
+  long entries;
+};
+
+class SchemaCache {
+  private:
+  struct Entry {
+    FDSet cover;
+    AttrSet key;
+  };
+  mutex lock;
+  list<pair<string, Entry>> entries;
+  unordered_map<string, list<pair<string, Entry>>::iterator> lookup;
+  size_t capacity;
+  long hits;
+  long misses;
+
+  public:
+  SchemaCache(size_t capacity);
+  static string keyOf(const RelationInput &input);
+  bool find(const string &schema, FDSet &cover, AttrSet &key);
+  void insert(const string &schema, const FDSet &cover, const AttrSet &key);
+  SchemaCacheStats getStats();
+};
+
+//Candidate keys (keys.cpp). enumerateKeys reports each key as soon as it
+//is found; returning false from onKey stops the search. findAllKeys stops
+//after limit keys.
+AttrSet reduceToKey(ClosureEngine &engine, const AttrSet &superkey, const AttrSet &attributes, const AttrSet &candidates);
+void enumerateKeys(const FDSet &fdset, const AttrSet &attributes, const function<bool(const AttrSet &)> &onKey);
+vector<AttrSet> findAllKeys(const FDSet &fdset, const AttrSet &attributes, size_t limit = SIZE_MAX);
+AttrSet getPrimeAttributes(const FDSet &fdset, const AttrSet &attributes);
+
+//Projects F onto fragments of the relation (projection.cpp). Closures
+//under F and finished projections are cached, so one engine should be
+//used for all fragments of a decomposition. The caches are locked, so the
+//engine can be shared by threads.
+class ProjectionEngine {
+  private:
+  ClosureEngine engine;
+  AttrSet lhsAttributes;
+  mutex cacheLock;
+  unordered_map<AttrSet, AttrSet, AttrSetHash> closures;
+  unordered_map<AttrSet, FDSet, AttrSetHash> projections;
+  const AttrSet &closureOf(const AttrSet &X);
+
+  public:
+  ProjectionEngine(const FDSet &fdset);
+  FDSet project(const AttrSet &fragment);
+};
+
+//Lossless join test (lossless.cpp)
+enum JoinTest { JOIN_LOSSY, JOIN_LOSSLESS, JOIN_UNDECIDED };
+JoinTest testJoinBySplits(const set<AttrSet> &decompositions, const AttrSet &attributes, const FDSet &fdset, vector<pair<AttrSet,AttrSet>> &joins);
+
+//The S matrix, chased semi-naively: an FD is applied to every group of
+//rows agreeing on its LHS, and only re-examined after a merge in one of
+//its LHS columns. The chase stops as soon as a row is all distinguished.
+class s_matrix {
+  private:
+  pmr::vector<int> core;
+  pmr::vector<int> parent;
+  pmr::vector<int> amap;
+  pmr::vector<int> distinguished;
+  pmr::vector<int> xcolumns;
+  pmr::vector<int> slots;
+  pmr::vector<int> group;
+  pmr::vector<int> groupSize;
+  pmr::vector<int> groupRows;
+  pmr::vector<int> groupStarts;
+  pmr::vector<char> columnChanged;
+  pmr::vector<int> changedColumns;
+  map<AttrSet, int> dmap;
+  int rows;
+  int columns;
+  bool complete;
+  set<AttrSet> decompositions;
+  AttrSet attributes;
+  const AttributeDictionary &dictionary;
+  int find(int column, int sym);
+  int symbolAt(int row, int column);
+  int groupRowsByX(const AttrSet &X);
+  void equateRows(const AttrSet &Y, const int *rowIndices, int count);
+  void makeDistinguished(int column, int sym);
+
+  public:
+  s_matrix(const set<AttrSet> &decompositions, const AttrSet &attributes, const AttributeDictionary &dictionary);
+  void chase(const FDSet &fdset);
+  bool hasAtypeRow();
+  int getRows() const { return rows; }
+  int getColumns() const { return columns; }
+  string cellName(int row, int column);
+  void printState(ostream &out = cout);
+};
+
+//Normal form synthesis (synthesis.cpp)
+set<AttrSet> synthesize3NF(const Relation &r);
+set<AttrSet> decomposeBCNF(const Relation &r);
+set<AttrSet> decomposeBCNFPolynomial(const Relation &r);
+
+//A node of a BCNF split tree: a fragment and, unless it is a leaf, the FD
+//X -> Y it was split on and its children (indices into the tree)
+struct BCNFNode {
+  AttrSet fragment;
+  FD split;
+  int left;
+  int right;
+};
+
+vector<BCNFNode> buildBCNFTree(const Relation &r, int threads = 1);
+vector<BCNFNode> buildBCNFTreePolynomial(const Relation &r);
+set<AttrSet> getTreeLeaves(const vector<BCNFNode> &tree);
+void printBCNFTree(const vector<BCNFNode> &tree, const AttributeDictionary &dictionary, ostream &out = cout);
+
+//Command line front-end shared by lj, 3nf and bcnf (tool.cpp, batch.cpp,
+//report.cpp, server.cpp, diskcache.cpp)
+enum Operation { OP_LJ, OP_3NF, OP_BCNF };
+
+//Reports are either the readable text the tools always printed, or one
+//JSON object per relation and line (NDJSON)
+enum OutputFormat { FORMAT_TEXT, FORMAT_JSON };
+
+//How bcnf splits fragments: by projecting F (the default) or by the
+//polynomial pair test
+enum BCNFStrategy { BCNF_PROJECTION, BCNF_POLYNOMIAL };
+
+struct ToolOptions {
+  Operation op;
+  bool forceTableau;
+  BCNFStrategy strategy;
+  bool printTree;
+  OutputFormat format;
+  bool quiet;
+  int threads;
+  string diskCache;
+};
+
+//Everything a tool works out for one relation. decompositions holds the
+//input fragments for lj and the result for 3nf and bcnf; tableau is the
+//chased S matrix (cell names by row), kept only when it will be printed.
+struct AnalysisResult {
+  string name;
+  Operation op;
+  bool ok;
+  string error;
+  AttributeDictionary dictionary;
+  AttrSet attributes;
+  AttrSet key;
+  FDSet cover;
+  vector<AttrSet> keys;
+  AttrSet prime;
+  set<AttrSet> decompositions;
+  JoinTest verdict;
+  bool chased;
+  vector<pair<AttrSet,AttrSet>> joins;
+  vector<vector<string>> tableau;
+  vector<BCNFNode> tree;
+};
+
+AnalysisResult computeResult(const RelationInput &input, const string &name, const ToolOptions &options, SchemaCache *schemas = NULL);
+
+//Results kept on disk between runs in the directory given by the
+//diskCache option (diskcache.cpp). Safe to share between processes.
+string resultCacheKey(const RelationInput &input, const ToolOptions &options);
+bool loadCachedResult(const string &directory, const string &key, AnalysisResult &result);
+void storeCachedResult(const string &directory, const string &key, const AnalysisResult &result);
+
+void writeTextResult(const AnalysisResult &result, const ToolOptions &options, ostream &out);
+void writeJSONResult(const AnalysisResult &result, const ToolOptions &options, ostream &out);
+
+bool analyzeRelation(const RelationInput &input, const string &name, const ToolOptions &options, ostream &out);
+vector<string> listBatchInputs(const string &spec);
+int runBatch(const vector<string> &files, const ToolOptions &options, ostream &out);
+int runStream(RelationReader &reader, const ToolOptions &options, ostream &out);
+int runServer(const string &socketPath, const ToolOptions &options, size_t schemaCacheSize);
+int runTool(int argc, char **argv, Operation op);
+
+#endif
@@ -0,0 +1,228 @@
+/*
+	Writers for the per-relation results of the tools: the readable text
+  report, and a compact JSON object per relation on one line (NDJSON).
+  Nothing here flushes; the caller's stream is flushed once at the end.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include "relational.h"
+
+using namespace std;
+
+static void writeTableau(const AnalysisResult &result, ostream &out) {
+
+  out<<"Following decompositions are present with indices as mentioned:\n";
+  int index = 0;
+  for(auto &decomp: result.decompositions) {
+    printSet(decomp, result.dictionary, out);
+    out<<" - "<<index++<<"\n";
+  }
+
+  out<<"Column number for attributes are as follows-\n";
+  int column = 0;
+  for(int attr: result.attributes) {
+    out<<result.dictionary.getName(attr)<<" - "<<column++<<"\n";
+  }
+
+  out<<"S Matrix is as follows\n";
+  for(auto &row: result.tableau) {
+    for(auto &cell: row) {
+      out<<cell<<" ";
+    }
+    out<<"\n";
+  }
+}
+
+static void writeFragments(const set<AttrSet> &fragments, const AttributeDictionary &dictionary, ostream &out) {
+  for(auto &fragment: fragments) {
+    printSet(fragment, dictionary, out);
+    out<<"\n";
+  }
+}
+
+//The report the tools have always printed. Quiet mode leaves out the
+//relation summary and every diagnostic dump, keeping only the answer.
+void writeTextResult(const AnalysisResult &result, const ToolOptions &options, ostream &out) {
+
+  if(!result.ok) {
+    out<<result.error<<"\n";
+    return;
+  }
+
+  if(!options.quiet) {
+    out<<"---------------\n";
+    out<<"Attributes:\n";
+    printSet(result.attributes, result.dictionary, out);
+    out<<"\nKey - ";
+    printSet(result.key, result.dictionary, out);
+    out<<"\nFDs\n";
+    printFD(result.cover, result.dictionary, out);
+    out<<"---------------\n";
+  }
+
+  if(result.op == OP_LJ) {
+    out<<(result.verdict == JOIN_LOSSLESS ? "SATISFIES LJ" : "FAILS LJ")<<"\n";
+    if(options.quiet) return;
+    out<<"---------------\n";
+    if(result.chased) {
+      writeTableau(result, out);
+    } else if(result.verdict == JOIN_LOSSLESS) {
+      out<<"Fragments join losslessly in this order:\n";
+      for(auto &join: result.joins) {
+        printSet(join.first, result.dictionary, out);
+        out<<"+ ";
+        printSet(join.second, result.dictionary, out);
+        out<<"\n";
+      }
+    } else {
+      out<<"No lossless binary join exists between the fragments\n";
+    }
+  } else if(result.op == OP_3NF) {
+    out<<"3NF LJ-DP Decomposition- \n";
+    writeFragments(result.decompositions, result.dictionary, out);
+  } else {
+    out<<"BCNF LJ Decomposition - \n";
+    writeFragments(result.decompositions, result.dictionary, out);
+    if(options.printTree && !options.quiet) {
+      out<<"BCNF split tree - \n";
+      printBCNFTree(result.tree, result.dictionary, out);
+    }
+  }
+}
+
+static void writeString(const string &s, ostream &out) {
+  out<<'"';
+  for(char c: s) {
+    if(c == '"' || c == '\\') {
+      out<<'\\'<<c;
+    } else if((unsigned char)c < 0x20) {
+      static const char *hex = "0123456789abcdef";
+      out<<"\\u00"<<hex[(c >> 4) & 0xf]<<hex[c & 0xf];
+    } else {
+      out<<c;
+    }
+  }
+  out<<'"';
+}
+
+static void writeSet(const AttrSet &s, const AttributeDictionary &dictionary, ostream &out) {
+  out<<'[';
+  bool first = true;
+  for(int attr: s) {
+    if(!first) out<<',';
+    writeString(dictionary.getName(attr), out);
+    first = false;
+  }
+  out<<']';
+}
+
+static void writeDependency(const AttrSet &X, const AttrSet &Y, const AttributeDictionary &dictionary, ostream &out) {
+  out<<"{\"lhs\":";
+  writeSet(X, dictionary, out);
+  out<<",\"rhs\":";
+  writeSet(Y, dictionary, out);
+  out<<'}';
+}
+
+static void writeSetList(const set<AttrSet> &sets, const AttributeDictionary &dictionary, ostream &out) {
+  out<<'[';
+  bool first = true;
+  for(auto &s: sets) {
+    if(!first) out<<',';
+    writeSet(s, dictionary, out);
+    first = false;
+  }
+  out<<']';
+}
+
+//One JSON object on one line. Quiet mode drops the join order, the split
+//tree and the tableau.
+void writeJSONResult(const AnalysisResult &result, const ToolOptions &options, ostream &out) {
+
+  out<<"{\"name\":";
+  writeString(result.name, out);
+  if(!result.ok) {
+    out<<",\"ok\":false,\"error\":";
+    writeString(result.error, out);
+    out<<"}\n";
+    return;
+  }
+
+  const AttributeDictionary &dictionary = result.dictionary;
+  out<<",\"ok\":true,\"attributes\":";
+  writeSet(result.attributes, dictionary, out);
+  out<<",\"key\":";
+  writeSet(result.key, dictionary, out);
+  out<<",\"cover\":[";
+  bool first = true;
+  for(auto &dep: result.cover) {
+    if(!first) out<<',';
+    writeDependency(dep.first, dep.second, dictionary, out);
+    first = false;
+  }
+  out<<']';
+
+  if(result.op == OP_LJ) {
+    out<<",\"fragments\":";
+    writeSetList(result.decompositions, dictionary, out);
+    out<<",\"lossless\":"<<(result.verdict == JOIN_LOSSLESS ? "true" : "false");
+    out<<",\"method\":"<<(result.chased ? "\"chase\"" : "\"splits\"");
+    if(!options.quiet && !result.chased && result.verdict == JOIN_LOSSLESS) {
+      out<<",\"joins\":[";
+      for(size_t i = 0; i<result.joins.size(); i++) {
+        if(i) out<<',';
+        out<<'[';
+        writeSet(result.joins[i].first, dictionary, out);
+        out<<',';
+        writeSet(result.joins[i].second, dictionary, out);
+        out<<']';
+      }
+      out<<']';
+    }
+    if(!result.tableau.empty()) {
+      out<<",\"tableau\":[";
+      for(size_t i = 0; i<result.tableau.size(); i++) {
+        if(i) out<<',';
+        out<<'[';
+        for(size_t j = 0; j<result.tableau[i].size(); j++) {
+          if(j) out<<',';
+          writeString(result.tableau[i][j], out);
+        }
+        out<<']';
+      }
+      out<<']';
+    }
+  } else {
+    if(result.op == OP_3NF) {
+      out<<",\"keys\":[";
+      for(size_t i = 0; i<result.keys.size(); i++) {
+        if(i) out<<',';
+        writeSet(result.keys[i], dictionary, out);
+      }
+      out<<"],\"prime\":";
+      writeSet(result.prime, dictionary, out);
+    }
+    out<<",\"decomposition\":";
+    writeSetList(result.decompositions, dictionary, out);
+    if(result.op == OP_BCNF && options.printTree && !options.quiet) {
+      out<<",\"tree\":[";
+      for(size_t i = 0; i<result.tree.size(); i++) {
+        const BCNFNode &node = result.tree[i];
+        if(i) out<<',';
+        out<<"{\"fragment\":";
+        writeSet(node.fragment, dictionary, out);
+        if(node.left >= 0) {
+          out<<",\"split\":";
+          writeDependency(node.split.first, node.split.second, dictionary, out);
+          out<<",\"children\":["<<node.left<<','<<node.right<<']';
+        }
+        out<<'}';
+      }
+      out<<']';
+    }
+  }
+  out<<"}\n";
+}
@@ -0,0 +1,79 @@
+/*
+	Cache of minimal covers and keys for the server. Minimizing the FDs and
+  finding a key are the costly steps every tool repeats for a relation,
+  and a service usually sends the same base schemas over and over.
+*/
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "relational.h"
+
+using namespace std;
+
+SchemaCache::SchemaCache(size_t capacity) {
+  this->capacity = capacity;
+  hits = 0;
+  misses = 0;
+}
+
+//The attribute names (ids follow name order, so they identify the ids)
+//and the FDs as lists of ids
+string SchemaCache::keyOf(const RelationInput &input) {
+  string schema;
+  for(int attr: input.attributes) {
+    schema += input.dictionary.getName(attr);
+    schema += ',';
+  }
+  for(auto &dep: input.fds) {
+    schema += '\n';
+    for(int attr: dep.first) {
+      schema += to_string(attr);
+      schema += ' ';
+    }
+    schema += '>';
+    for(int attr: dep.second) {
+      schema += ' ';
+      schema += to_string(attr);
+    }
+  }
+  return schema;
+}
+
+bool SchemaCache::find(const string &schema, FDSet &cover, AttrSet &key) {
+  lock_guard<mutex> guard(lock);
+  auto itr = lookup.find(schema);
+  if(itr == lookup.end()) {
+    misses++;
+    return false;
+  }
+  entries.splice(entries.begin(), entries, itr->second);
+  cover = itr->second->second.cover;
+  key = itr->second->second.key;
+  hits++;
+  return true;
+}
+
+void SchemaCache::insert(const string &schema, const FDSet &cover, const AttrSet &key) {
+  lock_guard<mutex> guard(lock);
+  if(capacity == 0 || lookup.count(schema)) return;
+  if(entries.size() >= capacity) {
+    lookup.erase(entries.back().first);
+    entries.pop_back();
+  }
+  Entry entry;
+  entry.cover = cover;
+  entry.key = key;
+  entries.push_front(make_pair(schema, entry));
+  lookup[schema] = entries.begin();
+}
+
+SchemaCacheStats SchemaCache::getStats() {
+  lock_guard<mutex> guard(lock);
+  SchemaCacheStats stats;
+  stats.hits = hits;
+  stats.misses = misses;
+  stats.entries = entries.size();
+  return stats;
+}
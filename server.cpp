@@ -0,0 +1,408 @@
+/*
+	Server mode: a resident process that answers lj, 3nf and bcnf requests
+  on a Unix domain socket, or on standard input and output. Requests are
+  analyzed on a work stealing thread pool shared by all connections, and
+  minimal covers and keys are kept in a schema cache between requests
+  (closures stay in the workers' closure caches as well).
+
+  Every request is a line followed by a body of the given length:
+
+    <lj | 3nf | bcnf> [json] [text] [quiet] [tableau] [tree] [polynomial] [name=N] <length>
+    <relation in the input file format, length bytes>
+
+  "stats" (no body) asks for request counts, p50 / p99 / max latencies and
+  cache counters as one JSON object. Every response is a line
+  "<ok | error> <length>" followed by that many bytes: the report, in the
+  format the tool prints. Responses on a connection come in request order,
+  though later requests may be analyzed while earlier ones still run.
+*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "relational.h"
+#include "threadpool.h"
+#include "stats.h"
+
+using namespace std;
+
+//Bodies longer than this are refused
+static const size_t MAX_REQUEST_BYTES = 64 << 20;
+
+//Latencies of this many most recent requests give the percentiles
+static const size_t LATENCY_SAMPLES = 8192;
+
+//Buffered reads from a file descriptor
+class FrameReader {
+  private:
+  int fd;
+  string buffer;
+  size_t offset;
+
+  bool fill() {
+    if(offset > 0) {
+      buffer.erase(0, offset);
+      offset = 0;
+    }
+    char chunk[65536];
+    while(true) {
+      ssize_t n = read(fd, chunk, sizeof(chunk));
+      if(n > 0) {
+        buffer.append(chunk, n);
+        return true;
+      }
+      if(n < 0 && errno == EINTR) continue;
+      return false;
+    }
+  }
+
+  public:
+  FrameReader(int fd) : fd(fd), offset(0) {}
+
+  bool readLine(string &line) {
+    while(true) {
+      size_t end = buffer.find('\n', offset);
+      if(end != string::npos) {
+        line.assign(buffer, offset, end - offset);
+        offset = end + 1;
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+      }
+      if(!fill()) return false;
+    }
+  }
+
+  bool readBytes(size_t length, string &body) {
+    while(buffer.size() - offset < length) {
+      if(!fill()) return false;
+    }
+    body.assign(buffer, offset, length);
+    offset += length;
+    return true;
+  }
+};
+
+static bool writeAll(int fd, const string &data) {
+  size_t written = 0;
+  while(written < data.size()) {
+    ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) return false;
+    written += n;
+  }
+  return true;
+}
+
+static string makeFrame(bool ok, const string &body) {
+  return string(ok ? "ok " : "error ") + to_string(body.size()) + "\n" + body;
+}
+
+//Service times (from a request being read to its response being ready) of
+//the most recent requests
+class LatencyWindow {
+  private:
+  mutex lock;
+  vector<double> samples;
+  size_t next;
+
+  public:
+  LatencyWindow() : next(0) {}
+
+  void add(double ms) {
+    lock_guard<mutex> guard(lock);
+    if(samples.size() < LATENCY_SAMPLES) {
+      samples.push_back(ms);
+    } else {
+      samples[next] = ms;
+      next = (next + 1) % LATENCY_SAMPLES;
+    }
+  }
+
+  //Latency at or below which the given fraction of the requests finished
+  double percentile(double fraction) {
+    vector<double> sorted;
+    {
+      lock_guard<mutex> guard(lock);
+      sorted = samples;
+    }
+    if(sorted.empty()) return 0;
+    size_t rank = min(sorted.size() - 1, (size_t)(fraction * sorted.size()));
+    nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+  }
+};
+
+struct ServerState {
+  ToolOptions options;
+  WorkStealingPool pool;
+  SchemaCache schemas;
+  LatencyWindow latencies;
+  atomic<long> requests;
+  atomic<long> failures;
+  chrono::steady_clock::time_point started;
+
+  ServerState(const ToolOptions &options, size_t schemaCacheSize)
+    : options(options), pool(options.threads), schemas(schemaCacheSize), requests(0), failures(0),
+      started(chrono::steady_clock::now()) {}
+};
+
+struct PendingResponse {
+  string frame;
+  bool done;
+};
+
+//The responses of one connection not yet written, oldest first
+struct Connection {
+  int out;
+  bool broken;
+  mutex lock;
+  condition_variable changed;
+  deque<shared_ptr<PendingResponse>> pending;
+};
+
+//Writes the finished responses at the front of the queue. Called with the
+//connection locked.
+static void flushResponses(Connection &connection) {
+  while(!connection.pending.empty() && connection.pending.front()->done) {
+    if(!connection.broken && !writeAll(connection.out, connection.pending.front()->frame)) {
+      connection.broken = true;
+    }
+    connection.pending.pop_front();
+  }
+  connection.changed.notify_all();
+}
+
+static void finishResponse(Connection &connection, const shared_ptr<PendingResponse> &response, const string &frame) {
+  lock_guard<mutex> guard(connection.lock);
+  response->frame = frame;
+  response->done = true;
+  flushResponses(connection);
+}
+
+static string statsReport(ServerState &server) {
+  SchemaCacheStats schemas = server.schemas.getStats();
+  ClosureCacheStats closures = getClosureCacheStats();
+  double uptime = chrono::duration<double>(chrono::steady_clock::now() - server.started).count();
+
+  ostringstream out;
+  out<<"{\"requests\": "<<server.requests<<", \"errors\": "<<server.failures
+     <<", \"uptime_seconds\": "<<uptime<<", \"threads\": "<<server.pool.size()
+     <<", \"latency_ms\": {\"p50\": "<<server.latencies.percentile(0.5)
+     <<", \"p99\": "<<server.latencies.percentile(0.99)<<", \"max\": "<<server.latencies.percentile(1)
+     <<"}, \"schema_cache\": {\"hits\": "<<schemas.hits<<", \"misses\": "<<schemas.misses
+     <<", \"entries\": "<<schemas.entries<<"}, \"closure_cache\": {\"hits\": "<<closures.hits
+     <<", \"subset_hits\": "<<closures.subsetHits<<", \"misses\": "<<closures.misses<<"}";
+  if(statsCompiledIn()) {
+    ostringstream phases;
+    printStats(phases, false);
+    string text = phases.str();
+    while(!text.empty() && text.back() == '\n') text.pop_back();
+    out<<", \"stats\": "<<text;
+  }
+  out<<"}\n";
+  return out.str();
+}
+
+//Reads the request line into the options for one relation, its name and
+//the length of its body. Returns false with a message for a bad request;
+//length is still set when the body can be skipped.
+static bool parseRequest(const string &line, const ToolOptions &defaults, ToolOptions &options, string &name, long &length, string &error) {
+
+  istringstream in(line);
+  vector<string> words;
+  string word;
+  while(in>>word) words.push_back(word);
+
+  length = -1;
+  if(words.size() < 2) {
+    error = "ERROR: expected <operation> [flags] <length>";
+    return false;
+  }
+  const string &last = words.back();
+  if(last.find_first_not_of("0123456789") == string::npos && last.size() < 12) {
+    length = stol(last);
+  }
+  if(length < 0) {
+    error = "ERROR: expected the body length at the end of the request line";
+    return false;
+  }
+  if((size_t)length > MAX_REQUEST_BYTES) {
+    error = "ERROR: request body too large";
+    return false;
+  }
+
+  options = defaults;
+  options.threads = 1;
+  if(words[0] == "lj") {
+    options.op = OP_LJ;
+  } else if(words[0] == "3nf") {
+    options.op = OP_3NF;
+  } else if(words[0] == "bcnf") {
+    options.op = OP_BCNF;
+  } else {
+    error = "ERROR: unknown operation " + words[0];
+    return false;
+  }
+
+  for(size_t i = 1; i + 1<words.size(); i++) {
+    const string &flag = words[i];
+    if(flag == "json") {
+      options.format = FORMAT_JSON;
+    } else if(flag == "text") {
+      options.format = FORMAT_TEXT;
+    } else if(flag == "quiet") {
+      options.quiet = true;
+    } else if(flag == "tableau" && options.op == OP_LJ) {
+      options.forceTableau = true;
+    } else if(flag == "tree" && options.op == OP_BCNF) {
+      options.printTree = true;
+    } else if(flag == "polynomial" && options.op == OP_BCNF) {
+      options.strategy = BCNF_POLYNOMIAL;
+    } else if(flag.compare(0, 5, "name=") == 0) {
+      name = flag.substr(5);
+    } else {
+      error = "ERROR: unknown flag " + flag;
+      return false;
+    }
+  }
+  return true;
+}
+
+//Answers the requests read from in on out until in is closed
+static void serveConnection(ServerState &server, int in, int out) {
+
+  FrameReader reader(in);
+  Connection connection;
+  connection.out = out;
+  connection.broken = false;
+  size_t window = 4 * server.pool.size();
+
+  string line;
+  while(reader.readLine(line)) {
+    if(line.empty()) continue;
+    auto received = chrono::steady_clock::now();
+
+    shared_ptr<PendingResponse> response(new PendingResponse());
+    response->done = false;
+    {
+      unique_lock<mutex> guard(connection.lock);
+      connection.changed.wait(guard, [&] { return connection.pending.size() < window; });
+      if(connection.broken) break;
+      connection.pending.push_back(response);
+    }
+
+    //Stats are taken once the earlier requests of the connection are
+    //answered, so that they are counted
+    if(line == "stats") {
+      {
+        unique_lock<mutex> guard(connection.lock);
+        connection.changed.wait(guard, [&] { return connection.pending.front() == response; });
+      }
+      finishResponse(connection, response, makeFrame(true, statsReport(server)));
+      continue;
+    }
+
+    ToolOptions options;
+    string name = "request " + to_string(server.requests + 1);
+    string error, body;
+    long length;
+    bool valid = parseRequest(line, server.options, options, name, length, error);
+    if(length >= 0 && !reader.readBytes(length, body)) {
+      finishResponse(connection, response, makeFrame(false, "ERROR: incomplete request body\n"));
+      break;
+    }
+    server.requests++;
+    if(!valid) {
+      server.failures++;
+      finishResponse(connection, response, makeFrame(false, error + "\n"));
+      continue;
+    }
+
+    server.pool.submit([&server, &connection, response, options, name, body, received] {
+      RelationInput input;
+      parseRelationText(body, input);
+      AnalysisResult result = computeResult(input, name, options, &server.schemas);
+      ostringstream report;
+      if(options.format == FORMAT_JSON) {
+        writeJSONResult(result, options, report);
+      } else {
+        writeTextResult(result, options, report);
+      }
+      if(!result.ok) server.failures++;
+      server.latencies.add(chrono::duration<double, milli>(chrono::steady_clock::now() - received).count());
+      finishResponse(connection, response, makeFrame(result.ok, report.str()));
+    });
+  }
+
+  unique_lock<mutex> guard(connection.lock);
+  connection.changed.wait(guard, [&] { return connection.pending.empty(); });
+}
+
+//Serves requests on standard input and output when socketPath is "-",
+//otherwise on a Unix domain socket created at socketPath, one thread per
+//connection reading its requests. Socket mode only returns on error.
+int runServer(const string &socketPath, const ToolOptions &options, size_t schemaCacheSize) {
+
+  //A client that goes away must not take the server with it
+  signal(SIGPIPE, SIG_IGN);
+  ServerState server(options, schemaCacheSize);
+
+  if(socketPath == "-") {
+    serveConnection(server, STDIN_FILENO, STDOUT_FILENO);
+    server.pool.wait();
+    return 0;
+  }
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if(socketPath.size() >= sizeof(address.sun_path)) {
+    cerr<<"Socket path too long: "<<socketPath<<endl;
+    return 1;
+  }
+  strcpy(address.sun_path, socketPath.c_str());
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listener < 0) {
+    cerr<<"Cannot create socket: "<<strerror(errno)<<endl;
+    return 1;
+  }
+  unlink(socketPath.c_str());
+  if(bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+    cerr<<"Cannot listen on "<<socketPath<<": "<<strerror(errno)<<endl;
+    close(listener);
+    return 1;
+  }
+
+  while(true) {
+    int client = accept(listener, NULL, NULL);
+    if(client < 0) {
+      if(errno == EINTR || errno == ECONNABORTED) continue;
+      cerr<<"Cannot accept connections: "<<strerror(errno)<<endl;
+      break;
+    }
+    thread([&server, client] {
+      serveConnection(server, client, client);
+      close(client);
+    }).detach();
+  }
+
+  close(listener);
+  unlink(socketPath.c_str());
+  return 1;
+}
@@ -0,0 +1,99 @@
+/*
+	Storage and reports for the statistics declared in stats.h. Counters
+  are relaxed atomics, so relations analyzed on different threads add to
+  the same totals.
+*/
+
+#include <iostream>
+#include <atomic>
+#include "relational.h"
+#include "stats.h"
+
+using namespace std;
+
+static const char *phaseNames[PHASE_COUNT] = {
+  "parse", "minimize", "findkey", "lossless", "chase", "3nf", "bcnf", "projection", "discover"
+};
+
+static const char *counterNames[STAT_COUNTER_COUNT] = {
+  "relations", "closures", "fd_scans", "keys", "chase_steps", "cells_changed",
+  "fragments_split", "fragments_pruned", "disk_cache_hits", "disk_cache_misses",
+  "partition_products", "fds_discovered"
+};
+
+static const char *counterHelp[STAT_COUNTER_COUNT] = {
+  "Relations analyzed",
+  "Attribute closures requested",
+  "FDs tested while computing closures",
+  "Candidate keys enumerated",
+  "FDs applied by the S matrix chase",
+  "S matrix cells given a new symbol",
+  "Fragments split by BCNF decomposition",
+  "3NF fragments dropped as contained in another",
+  "Results read from the on-disk cache",
+  "Results looked up in the on-disk cache and not found",
+  "Stripped partition products computed by FD discovery",
+  "Minimal FDs found in table data"
+};
+
+static atomic<long> phaseCalls[PHASE_COUNT];
+static atomic<long> phaseNanoseconds[PHASE_COUNT];
+static atomic<long> counters[STAT_COUNTER_COUNT];
+
+void addStat(StatCounter counter, long n) {
+  counters[counter].fetch_add(n, memory_order_relaxed);
+}
+
+void addPhaseTime(StatPhase phase, long nanoseconds) {
+  phaseCalls[phase].fetch_add(1, memory_order_relaxed);
+  phaseNanoseconds[phase].fetch_add(nanoseconds, memory_order_relaxed);
+}
+
+bool statsCompiledIn() {
+#ifdef RELATIONAL_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void printStats(ostream &out, bool prometheus) {
+
+  ClosureCacheStats cache = getClosureCacheStats();
+
+  if(prometheus) {
+    out<<"# HELP relational_phase_seconds_total Time spent in each phase"<<endl;
+    out<<"# TYPE relational_phase_seconds_total counter"<<endl;
+    for(int i = 0; i<PHASE_COUNT; i++) {
+      out<<"relational_phase_seconds_total{phase=\""<<phaseNames[i]<<"\"} "<<phaseNanoseconds[i] / 1e9<<endl;
+    }
+    out<<"# HELP relational_phase_calls_total Times each phase ran"<<endl;
+    out<<"# TYPE relational_phase_calls_total counter"<<endl;
+    for(int i = 0; i<PHASE_COUNT; i++) {
+      out<<"relational_phase_calls_total{phase=\""<<phaseNames[i]<<"\"} "<<phaseCalls[i]<<endl;
+    }
+    for(int i = 0; i<STAT_COUNTER_COUNT; i++) {
+      out<<"# HELP relational_"<<counterNames[i]<<"_total "<<counterHelp[i]<<endl;
+      out<<"# TYPE relational_"<<counterNames[i]<<"_total counter"<<endl;
+      out<<"relational_"<<counterNames[i]<<"_total "<<counters[i]<<endl;
+    }
+    out<<"# HELP relational_closure_cache_total Closure cache lookups by outcome"<<endl;
+    out<<"# TYPE relational_closure_cache_total counter"<<endl;
+    out<<"relational_closure_cache_total{result=\"hit\"} "<<cache.hits<<endl;
+    out<<"relational_closure_cache_total{result=\"subset_hit\"} "<<cache.subsetHits<<endl;
+    out<<"relational_closure_cache_total{result=\"miss\"} "<<cache.misses<<endl;
+    return;
+  }
+
+  out<<"{\"phases\": {";
+  for(int i = 0; i<PHASE_COUNT; i++) {
+    out<<(i ? ", " : "")<<"\""<<phaseNames[i]<<"\": {\"calls\": "<<phaseCalls[i]
+       <<", \"seconds\": "<<phaseNanoseconds[i] / 1e9<<"}";
+  }
+  out<<"}, \"counters\": {";
+  for(int i = 0; i<STAT_COUNTER_COUNT; i++) {
+    out<<(i ? ", " : "")<<"\""<<counterNames[i]<<"\": "<<counters[i];
+  }
+  out<<"}, \"closure_cache\": {\"hits\": "<<cache.hits<<", \"subset_hits\": "<<cache.subsetHits
+     <<", \"misses\": "<<cache.misses<<"}, \"closure_kernel\": \""<<closureKernelName()<<"\"}"<<endl;
+}
@@ -0,0 +1,77 @@
+/*
+	Instrumentation: per-phase timers and work counters, reported by the
+  tools' --stats option. Everything is compiled in only when
+  RELATIONAL_STATS is defined (make STATS=1); otherwise STAT_PHASE and
+  STAT_ADD expand to nothing and cost nothing.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+enum StatPhase {
+  PHASE_PARSE,
+  PHASE_MINIMIZE,
+  PHASE_FINDKEY,
+  PHASE_LOSSLESS,
+  PHASE_CHASE,
+  PHASE_3NF,
+  PHASE_BCNF,
+  PHASE_PROJECTION,
+  PHASE_DISCOVER,
+  PHASE_COUNT
+};
+
+enum StatCounter {
+  STAT_RELATIONS,
+  STAT_CLOSURES,
+  STAT_FD_SCANS,
+  STAT_KEYS,
+  STAT_CHASE_STEPS,
+  STAT_CELLS_CHANGED,
+  STAT_FRAGMENTS_SPLIT,
+  STAT_FRAGMENTS_PRUNED,
+  STAT_DISK_HITS,
+  STAT_DISK_MISSES,
+  STAT_PARTITION_PRODUCTS,
+  STAT_FDS_DISCOVERED,
+  STAT_COUNTER_COUNT
+};
+
+void addStat(StatCounter counter, long n);
+void addPhaseTime(StatPhase phase, long nanoseconds);
+
+//Adds the time from construction to destruction to a phase. Phases nest,
+//and time spent on several threads is summed.
+class PhaseTimer {
+  private:
+  StatPhase phase;
+  chrono::steady_clock::time_point start;
+
+  public:
+  PhaseTimer(StatPhase phase) : phase(phase), start(chrono::steady_clock::now()) {}
+  ~PhaseTimer() {
+    addPhaseTime(phase, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+  }
+};
+
+#ifdef RELATIONAL_STATS
+#define STAT_PHASE(phase) PhaseTimer phaseTimer(phase)
+#define STAT_ADD(counter, n) addStat(counter, n)
+#else
+#define STAT_PHASE(phase) ((void)0)
+#define STAT_ADD(counter, n) ((void)0)
+#endif
+
+//Whether this build collects statistics
+bool statsCompiledIn();
+
+//Writes everything collected so far as one JSON object, or in the
+//Prometheus text exposition format
+void printStats(ostream &out, bool prometheus);
+
+#endif
@@ -0,0 +1,321 @@
+/*
+	Lossless join decompositions of a relation into 3NF (dependency
+  preserving synthesis from the minimal cover) and into BCNF. BCNF
+  decompositions are built as split trees whose leaves are the fragments.
+*/
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include "relational.h"
+#include "stats.h"
+#include "threadpool.h"
+
+using namespace std;
+
+//Candidate keys compared when 3NF synthesis has to add a key fragment
+static const int MAX_KEY_CANDIDATES = 1000;
+
+//Fragments with fewer attributes than this are projected in well under
+//the time it takes to hand them to another thread
+static const int MIN_PARALLEL_FRAGMENT = 8;
+
+//Removes every fragment contained in another one. Fragments are visited
+//largest first and only tested against those kept so far, through an
+//inverted index holding, for every attribute, a bitset of the kept
+//fragments that contain it: a fragment lies inside a kept one exactly
+//when the bitsets of its attributes share a bit.
+static void removeContainedFragments(set<AttrSet> &decomps) {
+
+  pmr::memory_resource *arena = RelationArena::current();
+  pmr::vector<const AttrSet *> order(arena);
+  for(auto &decomp: decomps) {
+    order.push_back(&decomp);
+  }
+  stable_sort(order.begin(), order.end(), [](const AttrSet *a, const AttrSet *b) {
+    return a->count() > b->count();
+  });
+
+  set<AttrSet> kept;
+  int keptCount = 0;
+  pmr::vector<pmr::vector<uint64_t>> holders(arena);
+  pmr::vector<uint64_t> common(arena);
+
+  for(auto fragment: order) {
+    bool contained = false;
+    if(keptCount > 0) {
+      common.assign((keptCount + 63) / 64, ~(uint64_t)0);
+      contained = true;
+      for(int attr: *fragment) {
+        const pmr::vector<uint64_t> *bits = attr < (int)holders.size() ? &holders[attr] : NULL;
+        contained = false;
+        for(size_t w = 0; w<common.size(); w++) {
+          common[w] &= (bits != NULL && w < bits->size()) ? (*bits)[w] : 0;
+          if(common[w] != 0) contained = true;
+        }
+        if(!contained) break;
+      }
+    }
+    if(contained) {
+      STAT_ADD(STAT_FRAGMENTS_PRUNED, 1);
+      continue;
+    }
+
+    int id = keptCount++;
+    for(int attr: *fragment) {
+      if(attr >= (int)holders.size()) holders.resize(attr + 1);
+      holders[attr].resize(id / 64 + 1, 0);
+      holders[attr][id / 64] |= (uint64_t)1 << (id % 64);
+    }
+    kept.insert(*fragment);
+  }
+
+  decomps.swap(kept);
+}
+
+set<AttrSet> synthesize3NF(const Relation &r) {
+  STAT_PHASE(PHASE_3NF);
+
+  const FDSet &min_fd = r.getFDS();
+  map<AttrSet, AttrSet> m;
+  for(auto &dep: min_fd) {
+    m[dep.first] |= dep.second;
+  }
+
+  set<AttrSet> decomps;
+
+  for(auto &tuple: m) {
+    decomps.insert(tuple.first | tuple.second);
+  }
+
+  int decompHasKey = 0;
+  ClosureEngine engine(min_fd);
+  for(auto &decomp: decomps) {
+    AttrSet closure = engine.getClosure(decomp);
+    if(closure == r.getAttributes()) {
+      decompHasKey = 1;
+      break;
+    }
+  }
+
+  //Add the smallest candidate key; the one found by findKey wins ties.
+  //Relations can have exponentially many keys, so only the first
+  //MAX_KEY_CANDIDATES are compared.
+  if(!decompHasKey) {
+    AttrSet key = r.getKey();
+    int seen = 0;
+    enumerateKeys(min_fd, r.getAttributes(), [&](const AttrSet &candidate) {
+      if(candidate.count() < key.count()) key = candidate;
+      return ++seen < MAX_KEY_CANDIDATES;
+    });
+    decomps.insert(key);
+  }
+
+  removeContainedFragments(decomps);
+
+  return decomps;
+}
+
+//Finds an FD of the projection of F onto fragment whose LHS is not a
+//superkey of the fragment; returns false if the fragment is in BCNF
+static bool findBCNFSplit(ProjectionEngine &projector, const AttrSet &fragment, FD &split) {
+  FDSet newFD = projector.project(fragment);
+  ClosureEngine engine(newFD);
+  for(auto &dep: newFD) {
+    AttrSet closure = engine.getClosure(dep.first);
+    if(closure != fragment) {
+      split = dep;
+      return true;
+    }
+  }
+  return false;
+}
+
+static BCNFNode makeLeaf(const AttrSet &fragment) {
+  BCNFNode node;
+  node.fragment = fragment;
+  node.left = -1;
+  node.right = -1;
+  return node;
+}
+
+//Splits fragments from a worklist: every fragment is checked once and,
+//if it violates BCNF on X -> Y, is replaced by the children R - Y and XY.
+//With several threads the children are pushed onto a work stealing pool,
+//so independent subtrees are decomposed concurrently. The pool is only
+//started at the first split whose children both have at least
+//MIN_PARALLEL_FRAGMENT attributes; the split tree is mostly a chain, and
+//smaller relations are decomposed on the calling thread alone. Node 0 is
+//the whole relation.
+vector<BCNFNode> buildBCNFTree(const Relation &r, int threads) {
+  STAT_PHASE(PHASE_BCNF);
+
+  ProjectionEngine projector(r.getFDS());
+  vector<BCNFNode> tree;
+  mutex treeLock;
+  tree.push_back(makeLeaf(r.getAttributes()));
+
+  //Only the calling thread starts the pool: until it exists no other
+  //thread runs expand
+  unique_ptr<WorkStealingPool> pool;
+
+  function<void(int)> expand = [&](int id) {
+    AttrSet fragment;
+    {
+      lock_guard<mutex> guard(treeLock);
+      fragment = tree[id].fragment;
+    }
+
+    FD split;
+    if(!findBCNFSplit(projector, fragment, split)) return;
+    STAT_ADD(STAT_FRAGMENTS_SPLIT, 1);
+
+    AttrSet leftFragment = fragment - split.second;
+    AttrSet rightFragment = split.first | split.second;
+    int left, right;
+    {
+      lock_guard<mutex> guard(treeLock);
+      left = tree.size();
+      tree.push_back(makeLeaf(leftFragment));
+      right = tree.size();
+      tree.push_back(makeLeaf(rightFragment));
+      tree[id].split = split;
+      tree[id].left = left;
+      tree[id].right = right;
+    }
+
+    bool parallel = min(leftFragment.count(), rightFragment.count()) >= MIN_PARALLEL_FRAGMENT;
+    if(parallel && !pool && threads > 1) pool.reset(new WorkStealingPool(threads));
+    if(parallel && pool) {
+      pool->submit([&expand, left] { expand(left); });
+      pool->submit([&expand, right] { expand(right); });
+    } else {
+      expand(left);
+      expand(right);
+    }
+  };
+
+  expand(0);
+  if(pool) pool->wait();
+  return tree;
+}
+
+set<AttrSet> getTreeLeaves(const vector<BCNFNode> &tree) {
+  set<AttrSet> leaves;
+  for(auto &node: tree) {
+    if(node.left < 0) leaves.insert(node.fragment);
+  }
+  return leaves;
+}
+
+set<AttrSet> decomposeBCNF(const Relation &r) {
+  return getTreeLeaves(buildBCNFTree(r));
+}
+
+static void printNode(const vector<BCNFNode> &tree, int id, int depth, const AttributeDictionary &dictionary, ostream &out) {
+  const BCNFNode &node = tree[id];
+  out<<string(2 * depth, ' ');
+  printSet(node.fragment, dictionary, out);
+  if(node.left >= 0) {
+    out<<"split on ";
+    printSet(node.split.first, dictionary, out);
+    out<<"-> ";
+    printSet(node.split.second, dictionary, out);
+  }
+  out<<"\n";
+  if(node.left >= 0) {
+    printNode(tree, node.left, depth + 1, dictionary, out);
+    printNode(tree, node.right, depth + 1, dictionary, out);
+  }
+}
+
+//Prints every fragment indented under its parent, with the FD it was split on
+void printBCNFTree(const vector<BCNFNode> &tree, const AttributeDictionary &dictionary, ostream &out) {
+  printNode(tree, 0, 0, dictionary, out);
+}
+
+//Finds A and B in Y such that A is in the closure of Y - AB; returns false
+//if there is no such pair, in which case Y is in BCNF
+static bool findViolatingPair(ClosureEngine &engine, const AttrSet &Y, int &a, int &b) {
+  for(int x: Y) {
+    for(int y: Y) {
+      if(x == y) continue;
+      AttrSet rest = Y;
+      rest.erase(x);
+      rest.erase(y);
+      if(engine.getClosure(rest).contains(x)) {
+        a = x;
+        b = y;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+//BCNF decomposition in polynomial time (Tsou and Fischer), without
+//projecting F. While Z has a violating pair, Z is shrunk one attribute at
+//a time to a BCNF fragment XA with X -> A, which is split off, and the
+//search continues on Z - A. Each step is recorded as a split of Z into
+//Z - A and the leaf XA. Fragments may differ from buildBCNFTree.
+vector<BCNFNode> buildBCNFTreePolynomial(const Relation &r) {
+  STAT_PHASE(PHASE_BCNF);
+
+  ClosureEngine engine(r.getFDS());
+  vector<BCNFNode> tree;
+  tree.push_back(makeLeaf(r.getAttributes()));
+
+  //A constant C (an FD {} -> C) violates BCNF in every fragment with an
+  //attribute that is not constant, even one of two attributes, which the
+  //search below takes to be in BCNF; and it makes the violating pair test
+  //fire where there is no violation. So the constants are split off first,
+  //each on its own. A relation of constants only has {} as its key and
+  //is in BCNF.
+  int z = 0, a, b;
+  AttrSet constants = engine.getClosure(AttrSet()) & r.getAttributes();
+  if(r.getAttributes().isSubsetOf(constants)) return tree;
+  for(int c: constants) {
+    AttrSet C;
+    C.insert(c);
+    STAT_ADD(STAT_FRAGMENTS_SPLIT, 1);
+    tree[z].split = make_pair(AttrSet(), C);
+    tree[z].left = tree.size();
+    tree.push_back(makeLeaf(tree[z].fragment - C));
+    tree[z].right = tree.size();
+    tree.push_back(makeLeaf(C));
+    z = tree[z].left;
+  }
+
+  while(tree[z].fragment.count() > 2 && findViolatingPair(engine, tree[z].fragment, a, b)) {
+    AttrSet Y = tree[z].fragment;
+    int last = a;
+    while(Y.count() > 2 && findViolatingPair(engine, Y, a, b)) {
+      Y.erase(b);
+      last = a;
+    }
+    AttrSet X = Y;
+    X.erase(last);
+    AttrSet A;
+    A.insert(last);
+
+    STAT_ADD(STAT_FRAGMENTS_SPLIT, 1);
+    tree[z].split = make_pair(X, A);
+    tree[z].left = tree.size();
+    tree.push_back(makeLeaf(tree[z].fragment - A));
+    tree[z].right = tree.size();
+    tree.push_back(makeLeaf(Y));
+    z = tree[z].left;
+  }
+
+  return tree;
+}
+
+set<AttrSet> decomposeBCNFPolynomial(const Relation &r) {
+  return getTreeLeaves(buildBCNFTreePolynomial(r));
+}
@@ -0,0 +1,118 @@
+/*
+	Work stealing thread pool.
+*/
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include "threadpool.h"
+
+using namespace std;
+
+//Index of the pool worker running on this thread, -1 outside the pool
+static thread_local const WorkStealingPool *currentPool = NULL;
+static thread_local int currentWorker = -1;
+
+int defaultThreadCount() {
+  int n = thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+WorkStealingPool::WorkStealingPool(int threadCount) {
+  if(threadCount < 1) threadCount = 1;
+  queued = 0;
+  unfinished = 0;
+  next = 0;
+  stopping = false;
+  for(int i = 0; i<threadCount; i++) {
+    workers.push_back(unique_ptr<Worker>(new Worker()));
+  }
+  for(int i = 0; i<threadCount; i++) {
+    threads.push_back(thread(&WorkStealingPool::run, this, i));
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    lock_guard<mutex> guard(stateLock);
+    stopping = true;
+  }
+  workAvailable.notify_all();
+  for(auto &t: threads) {
+    t.join();
+  }
+}
+
+void WorkStealingPool::submit(function<void()> task) {
+  int target;
+  if(currentPool == this) {
+    target = currentWorker;
+  } else {
+    lock_guard<mutex> guard(stateLock);
+    target = next++ % workers.size();
+  }
+  {
+    lock_guard<mutex> guard(workers[target]->lock);
+    workers[target]->tasks.push_back(move(task));
+  }
+  {
+    lock_guard<mutex> guard(stateLock);
+    queued++;
+    unfinished++;
+  }
+  workAvailable.notify_one();
+}
+
+//Blocks until every submitted task, including tasks submitted by tasks,
+//has finished
+void WorkStealingPool::wait() {
+  unique_lock<mutex> guard(stateLock);
+  allDone.wait(guard, [&] { return unfinished == 0; });
+}
+
+bool WorkStealingPool::takeTask(int self, function<void()> &task) {
+  {
+    Worker &own = *workers[self];
+    lock_guard<mutex> guard(own.lock);
+    if(!own.tasks.empty()) {
+      task = move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  int n = workers.size();
+  for(int k = 1; k<n; k++) {
+    Worker &victim = *workers[(self + k) % n];
+    lock_guard<mutex> guard(victim.lock);
+    if(!victim.tasks.empty()) {
+      task = move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::run(int self) {
+  currentPool = this;
+  currentWorker = self;
+  while(true) {
+    {
+      unique_lock<mutex> guard(stateLock);
+      workAvailable.wait(guard, [&] { return stopping || queued > 0; });
+      if(queued == 0 && stopping) return;
+      queued--;
+    }
+
+    //A task is queued somewhere; claim it (another worker may be pushing it)
+    function<void()> task;
+    while(!takeTask(self, task)) {
+      this_thread::yield();
+    }
+    task();
+
+    lock_guard<mutex> guard(stateLock);
+    unfinished--;
+    if(unfinished == 0) allDone.notify_all();
+  }
+}
@@ -0,0 +1,52 @@
+/*
+	A fixed size thread pool with work stealing. Every worker owns a deque:
+  it pushes and pops tasks at the back of its own deque and, when that is
+  empty, steals from the front of the others. Tasks submitted from inside
+  a task go to the submitting worker's deque.
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+using namespace std;
+
+class WorkStealingPool {
+  private:
+  struct Worker {
+    mutex lock;
+    deque<function<void()>> tasks;
+  };
+
+  vector<unique_ptr<Worker>> workers;
+  vector<thread> threads;
+  mutex stateLock;
+  condition_variable workAvailable;
+  condition_variable allDone;
+  long queued;
+  long unfinished;
+  unsigned next;
+  bool stopping;
+
+  bool takeTask(int self, function<void()> &task);
+  void run(int self);
+
+  public:
+  WorkStealingPool(int threadCount);
+  ~WorkStealingPool();
+  int size() const { return workers.size(); }
+  void submit(function<void()> task);
+  void wait();
+};
+
+//Number of worker threads to use when none is requested
+int defaultThreadCount();
+
+#endif
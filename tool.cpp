@@ -0,0 +1,291 @@
+/*
+	The command line front-end shared by lj, 3nf and bcnf: option parsing
+  and the per-relation report each tool prints.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "relational.h"
+#include "threadpool.h"
+#include "stats.h"
+
+using namespace std;
+
+//Candidate keys listed in a 3NF result; there can be exponentially many
+static const size_t MAX_REPORTED_KEYS = 100;
+
+//Decides the lossless join, by closures when possible and by the chase
+//otherwise. The chased tableau is kept unless it will not be printed.
+static void testLosslessJoin(const Relation &r, const ToolOptions &options, AnalysisResult &result) {
+
+  result.verdict = JOIN_UNDECIDED;
+  result.chased = false;
+  if(!options.forceTableau) {
+    result.verdict = testJoinBySplits(r.getDecompositions(), r.getAttributes(), r.getFDS(), result.joins);
+  }
+  if(result.verdict != JOIN_UNDECIDED) return;
+
+  s_matrix s(r.getDecompositions(), r.getAttributes(), r.getDictionary());
+  s.chase(r.getFDS());
+  result.chased = true;
+  result.verdict = s.hasAtypeRow() ? JOIN_LOSSLESS : JOIN_LOSSY;
+
+  if(options.quiet) return;
+  result.tableau.resize(s.getRows());
+  for(int i = 0; i<s.getRows(); i++) {
+    for(int j = 0; j<s.getColumns(); j++) {
+      result.tableau[i].push_back(s.cellName(i, j));
+    }
+  }
+}
+
+//Builds the relation, taking its minimal cover and key from the schema
+//cache (if any) when the same attributes and FDs were seen before
+static Relation buildRelation(const RelationInput &input, SchemaCache *schemas) {
+  if(schemas == NULL) return Relation(input);
+
+  string schema = SchemaCache::keyOf(input);
+  FDSet cover;
+  AttrSet key;
+  if(schemas->find(schema, cover, key)) return Relation(input, cover, key);
+
+  Relation r(input);
+  schemas->insert(schema, r.getFDS(), r.getKey());
+  return r;
+}
+
+//Runs the selected tool on one relation. Invalid input gives a result
+//that is not ok and carries the error message. Intermediate structures
+//come from an arena freed on return; the result itself does not use it.
+//With a disk cache, a cached result is returned without any analysis and
+//new results (not errors) are stored.
+AnalysisResult computeResult(const RelationInput &input, const string &name, const ToolOptions &options, SchemaCache *schemas) {
+
+  RelationArena arena;
+  AnalysisResult result;
+  result.name = name;
+  result.op = options.op;
+  result.verdict = JOIN_UNDECIDED;
+  result.chased = false;
+
+  string cacheKey;
+  if(!options.diskCache.empty()) {
+    cacheKey = resultCacheKey(input, options);
+    if(loadCachedResult(options.diskCache, cacheKey, result)) {
+      result.ok = true;
+      result.dictionary = input.dictionary;
+      result.attributes = input.attributes;
+      return result;
+    }
+  }
+
+  try {
+    Relation r = buildRelation(input, schemas);
+    result.ok = true;
+    result.dictionary = r.getDictionary();
+    result.attributes = r.getAttributes();
+    result.key = r.getKey();
+    result.cover = r.getFDS();
+
+    if(options.op == OP_LJ) {
+      result.decompositions = r.getDecompositions();
+      testLosslessJoin(r, options, result);
+    } else if(options.op == OP_3NF) {
+      result.decompositions = synthesize3NF(r);
+      result.keys = findAllKeys(result.cover, result.attributes, MAX_REPORTED_KEYS);
+      result.prime = getPrimeAttributes(result.cover, result.attributes);
+    } else {
+      if(options.strategy == BCNF_POLYNOMIAL) {
+        result.tree = buildBCNFTreePolynomial(r);
+      } else {
+        result.tree = buildBCNFTree(r, options.threads);
+      }
+      result.decompositions = getTreeLeaves(result.tree);
+    }
+  } catch(const RelationError &e) {
+    result.ok = false;
+    result.error = e.what();
+  }
+
+  if(!cacheKey.empty() && result.ok) storeCachedResult(options.diskCache, cacheKey, result);
+  return result;
+}
+
+//Writes the report of the selected tool for one relation. Returns false
+//(after reporting the error) if the input is invalid.
+bool analyzeRelation(const RelationInput &input, const string &name, const ToolOptions &options, ostream &out) {
+
+  AnalysisResult result = computeResult(input, name, options);
+  if(options.format == FORMAT_JSON) {
+    writeJSONResult(result, options, out);
+  } else {
+    writeTextResult(result, options, out);
+  }
+  return result.ok;
+}
+
+static int usage(const string &tool) {
+  cout<<"Usage: ./"<<tool<<" [options] file.txt"<<endl;
+  cout<<"       ./"<<tool<<" [options] --batch <directory | glob | manifest>"<<endl;
+  cout<<"       ./"<<tool<<" [options] --stream <file | ->"<<endl;
+  cout<<"       ./"<<tool<<" [options] --serve <socket | ->"<<endl;
+  if(tool != "lj") {
+    cout<<"       ./"<<tool<<" [options] --discover table.csv"<<endl;
+  }
+  cout<<"Options:"<<endl;
+  cout<<"  -j, --jobs N   worker threads (default: one per core)"<<endl;
+  cout<<"  --cache N      closure cache entries per thread (default 4096, 0 disables)"<<endl;
+  cout<<"  --cache-stats  print closure cache hits and misses to stderr"<<endl;
+  cout<<"  --format F     report format: text (default) or json, one object per line"<<endl;
+  cout<<"  -q, --quiet    print only the answer, without the relation and diagnostic dumps"<<endl;
+  cout<<"  --disk-cache D keep results in directory D between runs (shareable)"<<endl;
+  cout<<"  --schema-cache N  minimal covers and keys kept by --serve (default 1024)"<<endl;
+  cout<<"  --stats[=F]    print phase timings and counters to stderr as json (default)"<<endl;
+  cout<<"                 or prometheus text; needs a build with make STATS=1"<<endl;
+  if(tool == "lj") {
+    cout<<"  --tableau      always run the S matrix chase and print it"<<endl;
+  }
+  if(tool == "bcnf") {
+    cout<<"  --strategy S   projection (default) or polynomial"<<endl;
+    cout<<"  --tree         also print the split tree and the FD behind each split"<<endl;
+  }
+  return 1;
+}
+
+int runTool(int argc, char **argv, Operation op) {
+
+  string tool = op == OP_LJ ? "lj" : (op == OP_3NF ? "3nf" : "bcnf");
+  ToolOptions options;
+  options.op = op;
+  options.forceTableau = false;
+  options.strategy = BCNF_PROJECTION;
+  options.printTree = false;
+  options.format = FORMAT_TEXT;
+  options.quiet = false;
+  options.threads = defaultThreadCount();
+
+  string fileName, batchSpec, streamSpec, socketPath;
+  bool discover = false;
+  long schemaCacheSize = 1024;
+  bool cacheStats = false;
+  string statsFormat;
+  for(int i = 1; i<argc; i++) {
+    string arg = argv[i];
+    if(arg == "--tableau" && op == OP_LJ) {
+      options.forceTableau = true;
+    } else if(arg == "--tree" && op == OP_BCNF) {
+      options.printTree = true;
+    } else if(arg == "--strategy" && op == OP_BCNF && i + 1 < argc) {
+      string strategy = argv[++i];
+      if(strategy == "projection") {
+        options.strategy = BCNF_PROJECTION;
+      } else if(strategy == "polynomial") {
+        options.strategy = BCNF_POLYNOMIAL;
+      } else {
+        return usage(tool);
+      }
+    } else if(arg == "--discover" && op != OP_LJ) {
+      discover = true;
+    } else if(arg == "--batch" && i + 1 < argc) {
+      batchSpec = argv[++i];
+    } else if(arg == "--stream" && i + 1 < argc) {
+      streamSpec = argv[++i];
+    } else if(arg == "--serve" && i + 1 < argc) {
+      socketPath = argv[++i];
+    } else if(arg == "--disk-cache" && i + 1 < argc) {
+      options.diskCache = argv[++i];
+    } else if(arg == "--schema-cache" && i + 1 < argc) {
+      schemaCacheSize = atol(argv[++i]);
+      if(schemaCacheSize < 0) return usage(tool);
+    } else if((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+      options.threads = atoi(argv[++i]);
+      if(options.threads < 1) return usage(tool);
+    } else if(arg == "--format" && i + 1 < argc) {
+      string format = argv[++i];
+      if(format == "text") {
+        options.format = FORMAT_TEXT;
+      } else if(format == "json") {
+        options.format = FORMAT_JSON;
+      } else {
+        return usage(tool);
+      }
+    } else if(arg == "-q" || arg == "--quiet") {
+      options.quiet = true;
+    } else if(arg == "--cache" && i + 1 < argc) {
+      int entries = atoi(argv[++i]);
+      if(entries < 0) return usage(tool);
+      setClosureCacheCapacity(entries);
+    } else if(arg == "--cache-stats") {
+      cacheStats = true;
+    } else if(arg == "--stats" || arg == "--stats=json" || arg == "--stats=prometheus") {
+      statsFormat = arg == "--stats=prometheus" ? "prometheus" : "json";
+    } else if(arg.size() > 1 && arg[0] == '-') {
+      return usage(tool);
+    } else {
+      fileName = arg;
+    }
+  }
+
+  if(!statsFormat.empty() && !statsCompiledIn()) {
+    cerr<<"Statistics are not compiled in; rebuild with make STATS=1"<<endl;
+    statsFormat.clear();
+  }
+
+  //Reports are written through cout's own buffer and flushed once at exit
+  ios::sync_with_stdio(false);
+
+  int status;
+  if(!socketPath.empty()) {
+    status = runServer(socketPath, options, schemaCacheSize);
+  } else if(!batchSpec.empty()) {
+    vector<string> files = listBatchInputs(batchSpec);
+    if(files.empty()) {
+      cout<<"No input files match "<<batchSpec<<endl;
+      return 1;
+    }
+    status = runBatch(files, options, cout);
+  } else if(!streamSpec.empty()) {
+    if(streamSpec == "-") {
+      RelationReader reader(cin);
+      status = runStream(reader, options, cout);
+    } else {
+      MappedFile file(streamSpec);
+      if(!file.isOpen()) {
+        cout<<"File failed to open"<<endl;
+        return 1;
+      }
+      RelationReader reader(file.getText());
+      status = runStream(reader, options, cout);
+    }
+  } else {
+    if(fileName.empty()) return usage(tool);
+
+    RelationInput input;
+    if(discover) {
+      try {
+        if(!discoverRelationFile(fileName, options.threads, input)) {
+          cout<<"File failed to open"<<endl;
+          return 1;
+        }
+      } catch(const RelationError &e) {
+        cout<<e.what()<<endl;
+        return 1;
+      }
+    } else if(!readRelationFile(fileName, input)) {
+      cout<<"File failed to open"<<endl;
+      return 1;
+    }
+    status = analyzeRelation(input, fileName, options, cout) ? 0 : 1;
+  }
+
+  if(cacheStats) {
+    ClosureCacheStats stats = getClosureCacheStats();
+    cerr<<"Closure cache: "<<stats.hits<<" hits, "<<stats.subsetHits<<" subset hits, "<<stats.misses<<" misses"<<endl;
+  }
+  if(!statsFormat.empty()) {
+    printStats(cerr, statsFormat == "prometheus");
+  }
+  return status;
+}